@@ -9,7 +9,10 @@
 #include "Psxris.h"
 
 // You have your constructor which needs to exist so it calls the base Scene class
-MainMenu::MainMenu(char *name) : Scene(name) {}
+MainMenu::MainMenu(char *name) : Scene(name) {
+    // Almost nothing moves in the menu so only redraw what actually changes
+    partialRedraw = true;
+}
 
 
 // The destructor is called when you load another scene and you HAVE to clean up your mess in here
@@ -19,7 +22,7 @@ MainMenu::~MainMenu()
     free(levelSelectBuf);
     delete controller1;
     
-    delete pixelFontTexture;
+    // Textures and sounds belong to the scene's fudgebundle, so they must not be deleted here
     delete pixelFont;
 
 
@@ -50,7 +53,7 @@ void MainMenu::sceneSetup()
 {
 
     // Like this we can set a background image from fudgebundle
-    Scene::setBackground("menubg");
+    Scene::setBackground("menubg"_fdg);
 
     // You can play CDDA tracks. All you need to do is put your mp3s or whatevers into assets/music and you can then index them
     // alphabetically (starting from two because no.1 is the data track.)
@@ -58,7 +61,7 @@ void MainMenu::sceneSetup()
     soundPlayCdda(2,1);
 
     // If you have a custom font you can load it in like this but it's got some requirements. I suggest just using the font you can find in the assets folder
-    pixelFontTexture = Scene::getTexture("font");
+    pixelFontTexture = Scene::getTexture("font"_fdg);
     pixelFont = new Font(pixelFontTexture);
 
 
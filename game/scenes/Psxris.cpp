@@ -264,6 +264,12 @@ uint8_t fallDelays[2][21] = {
     // For 60 FPS
     {54, 49, 45, 41, 37, 33, 28, 22, 17, 11, 10, 9, 8, 7, 6, 6, 5, 5, 4, 4, 3}};
 
+// Game logic runs at a fixed tick rate so pick the table that matches it
+// rather than the video mode.
+static uint8_t getFallDelay(uint8_t level) {
+    return fallDelays[(psbw_get_tick_rate() < 60) ? 0 : 1][level];
+}
+
 uint32_t scoringTable[9][4] = {
     // Points for 1 line, 2 lines, 3 lines, 4 lines
     {100, 400, 900, 2000},   // Level 0
@@ -288,20 +294,8 @@ Psxris::~Psxris()
     free(levelBuf);
 
     delete controller1;
-    delete pixelFontTexture;
     delete pixelFont;
 
-    delete blue;
-    delete green;
-    delete orange;
-    delete purple;
-    delete red;
-    delete turqoise;
-    delete yellow;
-    
-    delete gameOverSound;
-    delete placeSound;
-
     delete objScore;
     delete scoreText;
     
@@ -320,6 +314,9 @@ Psxris::~Psxris()
     delete currentlyPlayingLabel;
     delete currentlyPlayingLabelText;
 
+    delete objEffects;
+    delete lineClearParticles;
+
     cleanupArrays();
     
     Scene::~Scene();
@@ -327,23 +324,36 @@ Psxris::~Psxris()
 
 void Psxris::sceneSetup()
 {
-    Scene::setBackground("gamebg");
+    Scene::setBackground("gamebg"_fdg);
 
-    pixelFontTexture = Scene::getTexture("font");
+    pixelFontTexture = Scene::getTexture("font"_fdg);
     pixelFont = new Font(pixelFontTexture);
 
     controller1 = new Controller(CONTROLLER_PORT_1);
 
-    blue = Scene::getTexture("blue");
-    green = Scene::getTexture("green");
-    orange = Scene::getTexture("orange");
-    purple = Scene::getTexture("purple");
-    red = Scene::getTexture("red");
-    turqoise = Scene::getTexture("turqoise");
-    yellow = Scene::getTexture("yellow");
-
-    gameOverSound = Scene::getSound("gameover");
-    placeSound = Scene::getSound("place");
+    blue = Scene::getTexture("blue"_fdg);
+    green = Scene::getTexture("green"_fdg);
+    orange = Scene::getTexture("orange"_fdg);
+    purple = Scene::getTexture("purple"_fdg);
+    red = Scene::getTexture("red"_fdg);
+    turqoise = Scene::getTexture("turqoise"_fdg);
+    yellow = Scene::getTexture("yellow"_fdg);
+
+    gameOverSound = Scene::getSound("gameover"_fdg);
+    placeSound = Scene::getSound("place"_fdg);
+
+    // Line clear sparks. Objects added first are drawn on top of later ones,
+    // so this goes in before the blocks
+    objEffects = new GameObject(0, 0, 0);
+    lineClearParticles = new ParticleSystem(512);
+    lineClearParticles->additive = true;
+    lineClearParticles->lifetime = 20;
+    lineClearParticles->lifetimeVariance = 20;
+    lineClearParticles->speed = PARTICLE_ONE / 2;
+    lineClearParticles->speedVariance = PARTICLE_ONE * 2;
+    lineClearParticles->gravity = PARTICLE_ONE / 16;
+    objEffects->addComponent(lineClearParticles);
+    Scene::addGameObject(objEffects);
 
     setupArrays();
 
@@ -503,7 +513,7 @@ Texture *Psxris::getBlockTexture(BlockColor blockColor) {
 
 void Psxris::startGame() {
 
-    currentDelay = fallDelays[draw_get_graphics_mode()][currentLevel];
+    currentDelay = getFallDelay(currentLevel);
 
     blockType = randint(0, 6);
     nextBlockType = randint(0, 6);
@@ -771,6 +781,11 @@ void Psxris::checkFullLines()
             for (j = 0; j < FIELD_COLS; j++)
             {
                 gameArray[i][j] = Empty;
+
+                if (i >= 4)
+                {
+                    lineClearParticles->emit(8, FIELD_X + (j * CELL_SIZE) + (CELL_SIZE / 2), FIELD_Y + ((i - 4) * CELL_SIZE) + (CELL_SIZE / 2));
+                }
             }
             // Move rows down
             for (k = i; k > 0; k--)
@@ -812,7 +827,7 @@ void Psxris::checkFullLines()
         {
             currentLevel++;
             sprintf(levelBuf, "LEVEL: %u", currentLevel);
-            currentDelay = fallDelays[draw_get_graphics_mode()][currentLevel];
+            currentDelay = getFallDelay(currentLevel);
         }
     }
 }
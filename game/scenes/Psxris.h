@@ -4,6 +4,7 @@
 
 #include <psbw/GameObject.h>
 #include <psbw/Sprite.h>
+#include <psbw/ParticleSystem.h>
 #include <psbw/Text.h>
 #include <psbw/Controller.h>
 #include <psbw/Sound.h>
@@ -81,6 +82,9 @@ private:
     GameObject *currentlyPlayingLabel;
     Text* currentlyPlayingLabelText;
 
+    GameObject *objEffects;
+    ParticleSystem *lineClearParticles;
+
     Sprite *renderArray[FIELD_ROWS][FIELD_COLS];
     Sprite *previewRenderArray[4][4];
 
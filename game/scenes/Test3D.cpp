@@ -19,8 +19,8 @@ void Test3D::sceneSetup()
     Scene::camera = new Camera();
     cube = new GameObject(0,0,256);
     cubeMesh = new Mesh();
-    cubeMesh->mesh = Scene::getMesh("cube");
-    cubeMesh->texture = Scene::getTexture("dumbass");
+    cubeMesh->mesh = Scene::getMesh("cube"_fdg);
+    cubeMesh->texture = Scene::getTexture("dumbass"_fdg);
     cube->addComponent(cubeMesh);
     Scene::addGameObject(cube);
     ctrl = new Controller(CONTROLLER_PORT_1);
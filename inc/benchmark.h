@@ -0,0 +1,16 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Times memcpy(), memmove() and memcmp() against plain byte loops for a range of sizes and alignments and prints the
+ * results. Timer 0 must be counting CPU cycles, as set up by interrupt_init(). Runs at boot when MEMORY_BENCHMARK is set in
+ * GameSettings.yaml, but can be called from anywhere outside interrupt handlers
+ */
+void benchmark_memory();
+
+#ifdef __cplusplus
+}
+#endif
@@ -144,6 +144,14 @@ typedef enum {
 	CdlModeSpeed	= 1 << 7	// Read sectors at 2x speed instead of the default 1x. Should be cleared for CD-DA playback.
 } CdlModeFlag;
 
+// Not sent to the drive. Tells CdRead() and CdReadRetry() that the sectors are
+// Mode 2 Form 2, so only the 2324-byte payload of each one is stored (header,
+// subheader and EDC are skipped). Implies CdlModeSize.
+#define CdlModeForm2	(1 << 8)
+
+#define CD_FORM1_PAYLOAD	2048
+#define CD_FORM2_PAYLOAD	2324
+
 typedef enum {
 	CdlIDFlagAudio	= 1 << 4,	// Disc only contains CD-DA tracks.
 	CdlIDFlagNoDisc	= 1 << 6,	// No disc present.
@@ -721,8 +729,10 @@ int CdDataSync(int mode);
  * CdlSetmode command prior to starting the read.
  *
  * Each sector read is 2340 bytes long if the CdlModeSize bit is set in the
- * mode, 2048 bytes long otherwise. Ideally, the CdlModeSpeed bit shall be set
- * to enable double speed mode.
+ * mode, 2324 bytes long if CdlModeForm2 is set (for files stored as Mode 2
+ * Form 2 sectors, which have no ECC and thus more room for data) and 2048
+ * bytes long otherwise. Ideally, the CdlModeSpeed bit shall be set to enable
+ * double speed mode.
  *
  * Reading is done asynchronously. Use CdReadSync() to block until all data has
  * been read, or CdReadCallback() to register a callback to be executed on
@@ -0,0 +1,93 @@
+#pragma once
+#include "cdrom.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+	CdlSubmodeEOR	= 1 << 0,	// Last sector of a record
+	CdlSubmodeVideo	= 1 << 1,	// Sector contains video data
+	CdlSubmodeAudio	= 1 << 2,	// Sector contains XA-ADPCM data
+	CdlSubmodeData	= 1 << 3,	// Sector contains other data
+	CdlSubmodeForm2	= 1 << 5,	// Sector is Mode 2 Form 2 (2324-byte payload, no ECC)
+	CdlSubmodeEOF	= 1 << 7	// Last sector of a file
+} CdlSubmodeFlag;
+
+/**
+ * @brief Sector read by the streaming API.
+ *
+ * @details The header and XA subheader of the sector are kept in info, so the
+ * reader can tell Form 1 and Form 2 sectors apart and find the end of a file.
+ * The payload is stored in data without any of the headers.
+ */
+typedef struct CdlStreamSector {
+	CdlLOCINFOL	info;
+	uint32_t	_subheader_copy;
+	uint32_t	data[CD_FORM2_PAYLOAD / 4];
+} CdlStreamSector;
+
+/**
+ * @brief Returns the length of a streamed sector's payload in bytes (2048 for
+ * Form 1 sectors, 2324 for Form 2 sectors).
+ */
+static inline int CdStreamGetLength(const CdlStreamSector *sector) {
+	return (sector->info.submode & CdlSubmodeForm2) ? CD_FORM2_PAYLOAD : CD_FORM1_PAYLOAD;
+}
+
+/**
+ * @brief Starts streaming sectors into a ring buffer.
+ *
+ * @details Reads the given number of sectors (or up to the first sector with
+ * the EOF submode flag set) starting from pos into a ring buffer of slots
+ * sectors, in the background. Both Form 1 and Form 2 sectors can be streamed.
+ * Sectors are processed in the order they were read using CdStreamGetSector()
+ * and CdStreamRelease(). If the ring buffer fills up, reading is paused and
+ * resumed from the first sector that didn't fit once half of it is free.
+ *
+ * Unlike CdRead(), sectors are read with CdlReadS (no automatic retry), as a
+ * stream can usually tolerate a bad sector better than a stall. Only one
+ * stream or CdRead() can be active at a time.
+ *
+ * @param pos
+ * @param sectors
+ * @param ring
+ * @param slots Number of sectors the ring buffer can hold (>= 2)
+ * @param mode CD-ROM mode to apply prior to reading (CdlModeSize is implied)
+ * @return 1 if streaming started successfully or 0 in case of errors
+ *
+ * @see CdStreamSync(), CdStreamStop()
+ */
+int CdStreamStart(const CdlLOC *pos, int sectors, CdlStreamSector *ring, int slots, int mode);
+
+/**
+ * @brief Returns the oldest sector in the ring buffer that hasn't been
+ * released yet, or a null pointer if none has been read yet.
+ */
+CdlStreamSector *CdStreamGetSector(void);
+
+/**
+ * @brief Releases the sector returned by CdStreamGetSector(), making its slot
+ * available to the drive again.
+ */
+void CdStreamRelease(void);
+
+/**
+ * @brief Checks the stream's status and resumes reading if it was paused.
+ *
+ * @details Shall be called frequently (e.g. once per frame) while streaming.
+ *
+ * @return Number of sectors that are yet to be read or released, 0 once the
+ * whole stream has been processed or -1 in case of errors
+ */
+int CdStreamSync(void);
+
+/**
+ * @brief Stops streaming and restores the callback set using
+ * CdReadyCallback() before CdStreamStart() was called.
+ */
+void CdStreamStop(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "psbw/Collider.h"
+
+// Broadphase for Collider components. Each scene has a world which hashes
+// colliders by the COLLISION_CELL_SIZE cells they cover, so only colliders
+// sharing a cell are ever tested against each other.
+
+COLLISION_WORLD *collision_create_world();
+
+// Also detaches any colliders still in the world, so deleting them later is safe
+void collision_destroy_world(COLLISION_WORLD *world);
+
+void collision_add(COLLISION_WORLD *world, Collider *collider);
+void collision_remove(Collider *collider);
+
+/**
+ * \brief Moves colliders to the cells they cover now and calls onContact for every overlapping pair. Run after each logic tick
+ */
+void collision_update(COLLISION_WORLD *world);
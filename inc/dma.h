@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <ps1/registers.h>
+
+#define DMA_QUEUE_LENGTH 8 // Transfers waiting behind the running one, per channel
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Identifies a transfer handed to dma_queue(). A fence is done once that
+// transfer and all the ones queued before it on the same channel are.
+typedef struct DMA_FENCE {
+    DMAChannel channel;
+    uint32_t sequence;
+} DMA_FENCE;
+
+// Enables completion interrupts for the GPU, SPU and MDEC channels. DO NOT RUN FROM GAME CODE. Managed by engine.
+void dma_init();
+
+/**
+ * \brief Starts a transfer with the given register values, or queues it to start from the completion interrupt of the one in progress.
+ * Only transfers that need no other setup (e.g. GPU linked lists) should be queued behind others, anything else must call
+ * dma_wait_channel() first. Waits for room if DMA_QUEUE_LENGTH transfers are already queued. The data must stay valid until the returned fence is done
+ */
+DMA_FENCE dma_queue(DMAChannel channel, const void *address, uint32_t bcr, uint32_t chcr);
+
+/**
+ * \brief Returns a fence covering everything queued on the channel so far
+ */
+DMA_FENCE dma_get_fence(DMAChannel channel);
+
+bool dma_is_done(DMA_FENCE fence);
+
+/**
+ * \brief Waits for a fence, returning false if it times out. This also works with interrupts disabled
+ */
+bool dma_wait(DMA_FENCE fence);
+
+/**
+ * \brief Waits until the channel has nothing running or queued, so it can be programmed directly or GP0/SPU registers can be written
+ */
+bool dma_wait_channel(DMAChannel channel);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,21 +1,104 @@
 #pragma once
+#include "dma.h"
 #include "psbw/Scene.h"
 #include "psbw/Texture.h"
 
 #define GRAPHICS_MODE_PAL 0
 #define GRAPHICS_MODE_NTSC 1
+#define GRAPHICS_MODE_AUTO 2
 
 class Scene;
 
 void load_scene(Scene* scene);
 void draw_init();
-void draw_update(bool doGameTick);
+void draw_update(bool drawScene);
 
+// Runs a single logic tick of the active scene
+void tick_scene();
+
+/**
+ * \brief Switches between PAL (50 Hz) and NTSC (60 Hz) output, or the console's own with GRAPHICS_MODE_AUTO. Most TVs accept both
+ */
+void draw_set_graphics_mode(uint8_t mode);
 uint8_t draw_get_graphics_mode();
 
+/**
+ * \brief Returns the exact refresh rate of the current video mode and resolution in millihertz (the field rate in high resolution mode)
+ */
+int draw_get_refresh_rate();
+
+/**
+ * \brief Switches between the default resolution and 640x480 interlaced. Called by load_scene() according to Scene::highResolution
+ */
+void draw_set_high_resolution(bool enable);
+bool draw_is_high_resolution();
+int draw_get_screen_width();
+int draw_get_screen_height();
+
+/**
+ * \brief Returns true if the given 64x256 VRAM page overlaps the framebuffers in the current resolution
+ */
+bool vram_page_is_reserved(int page);
+
+/**
+ * \brief Same as vram_page_is_reserved() but for both resolutions, for data that stays in VRAM across scenes
+ */
+bool vram_page_is_reserved_in_any_mode(int page);
+
+// Words that components filling up the rest of the chain (ParticleSystem,
+// TileMap) leave free for the ones drawn after them
+#define CHAIN_HEADROOM 256
+
+/**
+ * \brief Allocates a packet in this frame's chain. If it doesn't fit, the packet is written to a scratch buffer and not drawn
+ */
 uint32_t *dma_get_chain_pointer(int numCommands, int zIndex);
 
-void vram_send_data(const void *data, int x, int y, int width, int height);
+/**
+ * \brief Returns how many more words (including packet headers) fit in this frame's chain
+ */
+int dma_get_chain_space();
+
+/**
+ * \brief Starts uploading data to VRAM. The data must stay valid until the returned fence is done
+ */
+DMA_FENCE vram_send_data(const void *data, int x, int y, int width, int height);
+
+/**
+ * \brief Queues a VRAM fill. Note that the GPU rounds x and width to multiples of 16 pixels
+ */
+void vram_fill(int x, int y, int width, int height, uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * \brief Queues a VRAM to VRAM copy, e.g. to move sprites around within an atlas
+ */
+void vram_blit(int srcX, int srcY, int x, int y, int width, int height);
+
+/**
+ * \brief Starts sending any queued fills and blits to the GPU without waiting for them
+ */
+void vram_flush();
+
+/**
+ * \brief Returns true if there are queued fills and blits the GPU hasn't finished yet
+ */
+bool vram_is_busy();
+
+/**
+ * \brief Flushes the queue and waits for the GPU to finish all fills and blits
+ */
+void vram_sync();
+
+/**
+ * \brief Grows rect to also cover other. Empty rectangles are ignored
+ */
+void rect_add(Rect *rect, const Rect *other);
+bool rect_overlaps(const Rect *a, const Rect *b);
+
+/**
+ * \brief Moves rect from world to screen coordinates using the active scene's 2D camera (unless screenSpace is set). Returns false if it's entirely off screen
+ */
+bool rect_to_screen(Rect *rect, bool screenSpace);
 
 Scene* get_active_scene();
 
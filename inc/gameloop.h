@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+
+// Initialize the fixed timestep scheduler. DO NOT RUN FROM GAME CODE. Managed by engine.
+void gameloop_init();
+
+/**
+ * \brief Runs as many logic ticks as the vblanks elapsed since the last call add up to (capped
+ * at MAX_TICKS_PER_FRAME) and then renders a single frame. Managed by engine.
+ */
+void gameloop_update();
+
+// Returns the number of logic ticks run since startup
+uint32_t gameloop_get_tick_count();
+
+// Returns the number of logic ticks per second
+int gameloop_get_tick_rate();
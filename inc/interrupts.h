@@ -1,15 +1,68 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <ps1/registers.h>
 #include <ps1/system.h>
 
+#define IRQ_CHANNEL_COUNT 11
+#define DMA_CHANNEL_COUNT 7
+#define IRQ_MAX_HANDLERS 4 // Per IRQ or DMA channel
+#define IRQ_LOAD_FRAMES 64 // Frames interrupt_get_load() averages over
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef void (*IRQHandler)(void);
+
+// A registered handler and how long it has taken to run. Cycles are counted
+// with timer 0 at the CPU clock, so a single call can't be measured past
+// 65535 cycles (about 1.9 ms), which no interrupt handler should come close to.
+typedef struct IRQ_HANDLER_STATS {
+    IRQHandler handler;
+    uint32_t calls;
+    uint32_t totalCycles;
+    uint16_t maxCycles;
+} IRQ_HANDLER_STATS;
+
 void interrupt_init();
 
+/**
+ * \brief Adds a handler for the given IRQ channel and unmasks it. Handlers of a channel run in the order they were added, right after the
+ * IRQ has been acknowledged (but not at the device side). Returns false if the channel already has IRQ_MAX_HANDLERS handlers
+ */
+bool interrupt_add_handler(IRQChannel channel, IRQHandler handler);
+
+/**
+ * \brief Removes a handler and masks the channel once it has none left
+ */
+void interrupt_remove_handler(IRQChannel channel, IRQHandler handler);
+
+// Same as interrupt_add_handler(), kept for existing drivers
 void interrupt_install_callback(IRQChannel channel, void (*cb)(void));
 
+/**
+ * \brief Adds a handler called when a transfer on the given DMA channel completes. The channel's completion flag is already cleared when it runs
+ */
+bool interrupt_add_dma_handler(DMAChannel channel, IRQHandler handler);
+void interrupt_remove_dma_handler(DMAChannel channel, IRQHandler handler);
+
+/**
+ * \brief Returns the handlers of a channel along with their timings. The array is valid until handlers are added or removed
+ */
+const IRQ_HANDLER_STATS *interrupt_get_stats(IRQChannel channel, int *count);
+const IRQ_HANDLER_STATS *interrupt_get_dma_stats(DMAChannel channel, int *count);
+
+void interrupt_reset_stats();
+
+/**
+ * \brief Returns how many CPU cycles all handlers took per frame on average over the last IRQ_LOAD_FRAMES frames. It's updated
+ * while VSync() waits for the vblank, so it stays at its last value while the game can't keep up
+ */
+uint32_t interrupt_get_load();
+
 #ifdef __cplusplus
 }
-#endif
\ No newline at end of file
+#endif
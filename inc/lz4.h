@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Decompresses a raw LZ4 block (without any frame header).
+ *
+ * @details The output buffer must be large enough to hold the entire
+ * decompressed block. Blocks are decompressed in a single pass with no
+ * additional memory, so this is fast enough on the PS1 to keep up with the
+ * CD drive.
+ *
+ * @param input Compressed data
+ * @param inputLength Length of the compressed data
+ * @param output Buffer to decompress into
+ * @param outputLength Size of the output buffer
+ * @return Number of bytes decompressed or -1 if the data is malformed
+ */
+int lz4_decompress(
+	const uint8_t *input, size_t inputLength, uint8_t *output,
+	size_t outputLength
+);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+
+// Header of an image compressed by tools/convertMdec.py, followed by the MDEC
+// bitstream. Macroblocks are stored in columns, top to bottom.
+typedef struct MDEC_IMAGE_HEADER
+{
+    char magic[4]; // "MDEC"
+    uint16_t width, height; // Multiples of 16
+    uint32_t length; // Length of the bitstream in 32-bit words
+} MDEC_IMAGE_HEADER;
+
+void mdec_init(void);
+
+/**
+ * \brief Returns true if data starts with an MDEC_IMAGE_HEADER
+ */
+bool mdec_is_image(const void *data);
+
+/**
+ * \brief Decodes an image with the MDEC and uploads it to VRAM one 16 pixel wide column at a time. Returns false on errors
+ */
+bool mdec_decode_to_vram(const MDEC_IMAGE_HEADER *image, int x, int y);
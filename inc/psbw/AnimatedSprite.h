@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "psbw/Component.h"
+#include "psbw/Vector.h"
+
+/**
+ * \brief A single resolved frame of an animation. Get an array of these with Scene::getAnimation()
+ */
+typedef struct AnimationFrame {
+    uint16_t page, clut;
+    uint8_t u, v;
+    uint8_t width, height;
+    uint8_t xMargin, yMargin;
+} AnimationFrame;
+
+/**
+ * \class AnimatedSprite
+ * \brief Add this component to your GameObject class to render a texture with multiple frames
+ */
+class AnimatedSprite : public Component {
+    public:
+
+        /**
+         * \brief Creates an animated sprite which shows a new frame every ticksPerFrame (at least 1) game ticks. Nothing is drawn if frames is nullptr
+         */
+        AnimatedSprite(AnimationFrame* frames, int numFrames, int ticksPerFrame);
+
+        int zIndex = 0;
+        int ticksPerFrame;
+
+        /**
+         * \brief If false the animation stops on its last frame instead of starting over
+         */
+        bool loop = true;
+
+        /**
+         * \brief Starts playing the animation from the first frame
+         */
+        void play();
+
+        /**
+         * \brief Stops the animation on the frame it's currently showing
+         */
+        void stop();
+
+        /**
+         * \brief Stops the animation and shows the given frame, clamped to the frames there are
+         */
+        void setFrame(int frame);
+        int getFrame();
+        bool isPlaying();
+
+        /**
+         * \brief Do not use - Handled by engine
+         */
+        void execute(GameObject* parent) override;
+        bool getBounds(GameObject* parent, Rect* bounds) override;
+        uint32_t getStateHash() override;
+
+    private:
+        AnimationFrame* _frames;
+        int _numFrames;
+
+        uint32_t _startTick;
+        int _stoppedFrame;
+        bool _playing;
+
+        bool _getScreenBounds(GameObject* parent, AnimationFrame* frame, Rect* bounds);
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "psbw/Component.h"
+#include "psbw/GameObject.h"
+#include "psbw/Vector.h"
+
+class Collider;
+
+typedef struct COLLISION_WORLD COLLISION_WORLD;
+typedef struct COLLISION_NODE COLLISION_NODE;
+
+typedef void (*ColliderCallback)(Collider *self, Collider *other);
+
+/**
+ * \class Collider
+ * \brief A box that follows a GameObject and reports when it touches other colliders in the scene. Register it with Scene::addCollider()
+ */
+class Collider : public Component {
+    public:
+
+        /**
+         * \brief Creates a width x height box whose top left corner is at the owner's position plus relPos
+         */
+        Collider(GameObject *owner, int width, int height);
+
+        /**
+         * \brief Also removes the collider from its scene
+         */
+        ~Collider();
+
+        GameObject *getOwner();
+
+        /**
+         * \brief Returns the box in world coordinates
+         */
+        Rect getRect();
+
+        /**
+         * \brief Returns true if the two boxes overlap right now, without waiting for the next tick
+         */
+        bool overlaps(Collider *other);
+
+        int width, height;
+
+        /**
+         * \brief Colliders only touch if each one's layer is in the other's mask, e.g. so enemy bullets don't hit enemies
+         */
+        uint16_t layer = 1;
+        uint16_t mask = 0xffff;
+
+        /**
+         * \brief Set this for colliders that never move, such as walls. They are never checked against each other
+         */
+        bool isStatic = false;
+
+        /**
+         * \brief Turns the collider off without removing it from the scene
+         */
+        bool enabled = true;
+
+        /**
+         * \brief Called after every tick for each collider this one overlaps. Don't delete colliders from it, flag them and do it in sceneLoop() instead
+         */
+        ColliderCallback onContact = nullptr;
+        void *userData = nullptr;
+
+        /**
+         * \brief Does nothing, colliders aren't drawn
+         */
+        void execute(GameObject* parent) override;
+
+        // Spatial hash bookkeeping. Managed by engine. DO NOT USE IN GAME CODE!
+        COLLISION_WORLD *_world = nullptr;
+        COLLISION_NODE *_nodes = nullptr;
+        Collider *_next = nullptr;
+        int16_t _cellX0, _cellY0, _cellX1, _cellY1;
+
+    private:
+        GameObject *_owner;
+};
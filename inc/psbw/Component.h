@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdint.h>
+
 #include "psbw/Vector.h"
 
 class GameObject;
@@ -14,5 +16,25 @@ class Component {
 public:
     // Run function of selected component. Managed by engine. DO NOT RUN IN GAME CODE!
     virtual void execute(GameObject* parent) = 0;
+
+    /**
+     * \brief Returns the area of the screen the component draws to, used for partial redraws. If this returns false the whole screen is redrawn every frame
+     */
+    virtual bool getBounds(GameObject* parent, Rect* bounds) { return false; }
+
+    /**
+     * \brief Returns a hash of anything other than the position that changes how the component looks, used for partial redraws
+     */
+    virtual uint32_t getStateHash() { return 0; }
+
     Vector3D relPos = {0,0,0};
+
+    /**
+     * \brief Set this for HUD elements (score, menus...) so they stay put when the scene's 2D camera moves
+     */
+    bool screenSpace = false;
+
+    // Bounds and state the component was last drawn with. Managed by engine. DO NOT USE IN GAME CODE!
+    Rect _drawnBounds = {0,0,0,0};
+    uint32_t _drawnStateHash = 0;
 };
@@ -5,6 +5,7 @@ class Font {
     public:
         Font(Texture *texture);
         void printString(int x, int y, char *str, int zIndex);
+        void measureString(char *str, int *width, int *height);
     private:
         Texture *_tex;
 };
@@ -1,10 +1,12 @@
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
 
 #include "psbw/Texture.h"
 #include "psbw/Sound.h"
 #include "psbw/Vector.h"
 #include "psbw/BWM.h"
+#include "psbw/AnimatedSprite.h"
 
 typedef struct [[gnu::packed]] FDG_INDEX
 {
@@ -27,6 +29,18 @@ typedef struct [[gnu::packed]] FDG_INDEX
 } FDG_INDEX;
 
 
+// Version 3 bundles (made by tools/compressBundle.py) store this right after
+// the hash table, followed by the compressed length of each block as an array
+// of uint16_t. The blocks of the VRAM, SPU and RAM sections are stored back to
+// back after the index section. A block whose length equals its uncompressed
+// length is stored uncompressed.
+typedef struct [[gnu::packed]] FDG_COMPRESSION_HEADER
+{
+    uint32_t blockSize; // Uncompressed size of each block (except the last one of each section)
+    uint16_t numBlocks[3]; // Number of blocks in the VRAM, SPU and RAM sections
+    uint16_t _reserved;
+} FDG_COMPRESSION_HEADER;
+
 typedef struct [[gnu::packed]] FDG_HASH_ENTRY
 {
     uint32_t hash; // Full hash of entry's name
@@ -37,25 +51,175 @@ typedef struct [[gnu::packed]] FDG_HASH_ENTRY
 } FDG_HASH_ENTRY;
 
 
+/**
+ * \brief Hashes an asset name the same way fudgebundle does. Runs at compile time when given a constant
+ */
+constexpr uint32_t fdg_hash(const char *str) {
+    uint32_t value = 0;
+
+    while (*str)
+        value = ((uint32_t) *(str++)) + (value << 6) + (value << 16) - value;
+
+    return value;
+}
+
+/**
+ * \brief An asset name hashed at compile time. Create one with the _fdg suffix, e.g. "font"_fdg
+ */
+typedef struct FDG_NAME {
+    uint32_t hash;
+} FDG_NAME;
+
+consteval FDG_NAME operator""_fdg(const char *str, size_t length) {
+    return FDG_NAME { fdg_hash(str) };
+}
+
+// Entries in the RAM section are only read from the CD when first used and
+// freed again (least recently used first) once the bundle's cache budget is
+// exceeded, unless they are pinned.
+typedef struct FDG_CACHE_ENTRY
+{
+    uint8_t* buffer; // Buffer the entry was read into, nullptr if not resident
+    uint8_t* data; // Start of the entry's data within buffer
+    uint32_t size; // Size of buffer
+    uint32_t lastUsed;
+    uint16_t pins;
+    bool background; // File entry was decoded as a background, its descriptor is a Vector2D
+} FDG_CACHE_ENTRY;
+
+class Fudgebundle;
+
+// Slot of the registry that maps names to entries across all loaded bundles.
+// Empty slots have a hash of 0.
+typedef struct FDG_REGISTRY_ENTRY
+{
+    uint32_t hash;
+    Fudgebundle* bundle;
+    FDG_HASH_ENTRY* entry;
+} FDG_REGISTRY_ENTRY;
+
+// Maximum number of bundles loaded at the same time
+#define FDG_MAX_BUNDLES 8
+
 class Fudgebundle {
     public:
-        Fudgebundle(char* filename);
+        /**
+         * \brief Loads a bundle from the CD. Bundles must be freed in the reverse order they were loaded. Pass persistent = true for bundles that stay loaded across scenes, so they avoid VRAM used by either resolution's framebuffers
+         */
+        Fudgebundle(char* filename, bool persistent = false);
         ~Fudgebundle();
         Texture *fudgebundle_get_texture(uint32_t hash);
+        AnimationFrame *fudgebundle_get_animation(uint32_t hash, int *numFrames);
         Sound *fudgebundle_get_sound(uint32_t hash);
         Vector2D *fudgebundle_get_background(uint32_t hash);
         BWM* fudgebundle_get_mesh(uint32_t hash);
 
+        /**
+         * \brief Reads an entry into RAM ahead of time, so using it later doesn't have to wait for the CD
+         */
+        void fudgebundle_prefetch(uint32_t hash);
+
+        /**
+         * \brief Keeps an entry in RAM until it's unpinned as many times as it was pinned. Meshes are pinned for as long as the bundle is loaded
+         */
+        void fudgebundle_pin(uint32_t hash);
+        void fudgebundle_unpin(uint32_t hash);
+
+        /**
+         * \brief Sets how many bytes of entries can stay in RAM before the least recently used ones are freed. Defaults to BUNDLE_CACHE_SIZE
+         */
+        void fudgebundle_set_cache_budget(uint32_t bytes);
+
+        /**
+         * \brief Same as the getters above but searching all loaded bundles at once. If several bundles contain the same name, the most recently loaded one wins
+         */
+        static Texture *fudgebundle_find_texture(uint32_t hash);
+        static AnimationFrame *fudgebundle_find_animation(uint32_t hash, int *numFrames);
+        static Sound *fudgebundle_find_sound(uint32_t hash);
+        static Vector2D *fudgebundle_find_background(uint32_t hash);
+        static BWM* fudgebundle_find_mesh(uint32_t hash);
+        static void fudgebundle_find_prefetch(uint32_t hash);
+
+        /**
+         * \brief Returns where an entry's data is on the CD (the first sector and the offset into it) so it can be read in pieces, e.g. by TileMap. Only works for uncompressed bundles
+         */
+        static bool fudgebundle_find_location(uint32_t hash, int *lba, uint32_t *offset, uint32_t *length);
+
+        /**
+         * \brief Returns the raw data of a file entry (e.g. a music sequence) and its length. The entry is pinned, so the data stays in RAM until its bundle is unloaded
+         */
+        static uint8_t *fudgebundle_find_file(uint32_t hash, uint32_t *length);
+
+        /**
+         * \brief Returns the bundle with the given file name, loading it unless it's still resident from an earlier scene. Scenes get their bundles this way
+         */
+        static Fudgebundle *fudgebundle_acquire(char *filename);
+
+        /**
+         * \brief Releases a bundle returned by fudgebundle_acquire(). It stays resident for later scenes while SCENE_CACHE_SIZE and free VRAM and SPU RAM allow
+         */
+        static void fudgebundle_release(Fudgebundle *bundle);
+
+        /**
+         * \brief Reserves count free VRAM pages next to each other in the same row, after those of all loaded bundles, for data that doesn't come from a bundle (e.g. video frames). Returns the first page or -1 if they don't fit
+         */
+        static int fudgebundle_alloc_pages(int count);
+
+        /**
+         * \brief Frees pages reserved by fudgebundle_alloc_pages(), starting from the given page. Pages must be freed in the reverse order they were reserved and before any bundle loaded after them
+         */
+        static void fudgebundle_free_pages(int page);
+
     private:
         FDG_INDEX* _fdg_index;
         FDG_HASH_ENTRY* _hash_table;
-        uint8_t* _ram_data;
+        FDG_COMPRESSION_HEADER* _compression; // nullptr for uncompressed bundles
+
+        int _file_lba;
+        uint32_t _ram_offset; // Offset of the RAM section (or its first block) within the file
+
+        FDG_CACHE_ENTRY* _cache;
+        uint32_t _cache_used, _cache_budget, _cache_clock;
+
+        // Decoded Texture, Sound or BWM for each entry of the hash table (or
+        // nullptr), so lookups return the same object every time. Textures
+        // and sounds are decoded into the two arrays when the bundle is
+        // loaded, meshes the first time they are requested.
+        void** _descriptors;
+        Texture* _textures;
+        Sound* _sounds;
 
         uint8_t _pageCount;
         uint8_t _entry_texpage;
+        bool _persistent;
+        uint32_t _spu_base;
+
+        char* _name; // nullptr unless the bundle was loaded by fudgebundle_acquire()
+        int _users;
+        bool _high_resolution; // Resolution the bundle's pages were allocated for
 
         int _fudgebundle_load(uint8_t* data);
+        void _fudgebundle_decode_entries();
+
+        bool _fudgebundle_read_ram(uint32_t offset, uint32_t length, FDG_CACHE_ENTRY *out);
+        uint32_t _fudgebundle_read_size(uint32_t offset, uint32_t length);
+        void _fudgebundle_preload_descriptors();
+        void _fudgebundle_evict(uint32_t needed);
+        uint8_t *_fudgebundle_get_data(FDG_HASH_ENTRY *entry);
         FDG_HASH_ENTRY *_fudgebundle_get_entry(uint32_t hash);
+
+        Texture *_fudgebundle_texture(FDG_HASH_ENTRY *entry);
+        AnimationFrame *_fudgebundle_animation(FDG_HASH_ENTRY *entry, int *numFrames);
+        Sound *_fudgebundle_sound(FDG_HASH_ENTRY *entry);
+        Vector2D *_fudgebundle_background(FDG_HASH_ENTRY *entry);
+        BWM *_fudgebundle_mesh(FDG_HASH_ENTRY *entry);
+
+        bool _fudgebundle_is_unused();
+        uint32_t _fudgebundle_ram_usage();
+
+        static void _fudgebundle_make_room(int pages, uint32_t spuLength, bool anyMode);
+        static void _fudgebundle_trim_resident();
+        static void _fudgebundle_rebuild_registry();
+        static FDG_REGISTRY_ENTRY *_fudgebundle_registry_find(uint32_t hash);
 };
 
-uint32_t fdg_hash(const char *str);
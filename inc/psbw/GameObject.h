@@ -21,7 +21,11 @@ public:
     /**
      * \brief Do not use. This function is critical to be called at the right time and it's handled by the engine
     */
-    void execute();
+    void execute(const Rect* clip = nullptr);
+    /**
+     * \brief Do not use. Grows dirty to cover any component that moved or changed since the last call. Returns false if a component can't be tracked
+    */
+    bool trackChanges(Rect* dirty);
     void addComponent(Component* component);
 private:
     COMPONENT_ENTRY _linked_list;
@@ -6,3 +6,28 @@
 */
 void psbw_load_scene(Scene* scene);
 Scene* psbw_get_active_scene();
+
+/**
+* \brief Loads a bundle whose assets (e.g. fonts and UI sounds) stay loaded across scenes and can be looked up from any of them. Call it before loading the first scene
+*/
+void psbw_load_common_bundle(char *filename);
+
+/**
+* \brief Returns the number of game logic ticks (calls to sceneLoop()) since startup. Use this as a timer
+*/
+uint32_t psbw_get_tick_count();
+
+/**
+* \brief Returns the number of game logic ticks per second. This is the same on PAL and NTSC
+*/
+int psbw_get_tick_rate();
+
+/**
+* \brief Returns the display's refresh rate in millihertz, e.g. 59826 on NTSC. Use it to work out how many frames are drawn per tick
+*/
+int psbw_get_refresh_rate();
+
+/**
+* \brief Forces 50 Hz (GRAPHICS_MODE_PAL) or 60 Hz (GRAPHICS_MODE_NTSC) video output, or GRAPHICS_MODE_AUTO to go back to the console's region. Game speed is not affected
+*/
+void psbw_set_video_mode(uint8_t mode);
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "psbw/Component.h"
+#include "psbw/Vector.h"
+
+// Particle positions and velocities have 8 fractional bits, so a speed of 256
+// moves a particle by one pixel per tick
+#define PARTICLE_ONE 256
+
+/**
+ * \class ParticleSystem
+ * \brief Add this component to your GameObject class to draw lots of small dots or squares (sparks, debris, dust...) without a GameObject per particle
+ */
+class ParticleSystem : public Component {
+    public:
+
+        /**
+         * \brief Creates a particle system which can have up to maxParticles alive at once. Their memory is allocated up front
+         */
+        ParticleSystem(int maxParticles);
+        ~ParticleSystem();
+
+        /**
+         * \brief Spawns count particles at the given position in the world (or on screen if screenSpace is set) using the settings below. Particles that don't fit are not spawned. They don't follow the GameObject once spawned
+         */
+        void emit(int count, int x, int y);
+
+        /**
+         * \brief Removes all particles
+         */
+        void clear();
+        int getCount();
+
+        Vector3D color = {255, 255, 255};
+
+        /**
+         * \brief How many ticks particles stay alive for, plus a random amount up to lifetimeVariance
+         */
+        int lifetime = 30;
+        int lifetimeVariance = 0;
+
+        /**
+         * \brief Initial speed in 1/256ths of a pixel per tick, plus a random amount up to speedVariance
+         */
+        int speed = PARTICLE_ONE;
+        int speedVariance = 0;
+
+        /**
+         * \brief Direction particles are emitted in, with 4096 being a full turn and 0 pointing right. They are spread randomly up to spread/2 either way
+         */
+        int angle = 0;
+        int spread = 4096;
+
+        /**
+         * \brief Added to the vertical speed of particles every tick
+         */
+        int gravity = 0;
+
+        /**
+         * \brief Size of particles in pixels. 1 draws single pixels, which is the cheapest
+         */
+        int size = 1;
+
+        /**
+         * \brief Darkens particles to black as they reach the end of their life. Looks best with additive set, as they fade out instead
+         */
+        bool fade = true;
+
+        /**
+         * \brief Adds particles to what's behind them instead of covering it
+         */
+        bool additive = false;
+
+        int zIndex = 0;
+
+        /**
+         * \brief Do not use - Handled by engine
+         */
+        void execute(GameObject* parent) override;
+
+    private:
+        int _max, _count;
+        uint32_t _lastTick;
+
+        // Particles are stored as a structure of arrays, all in one block,
+        // with the live ones packed at the start so the update and draw loops
+        // don't have to skip anything.
+        void *_pool;
+        int32_t *_x, *_y;
+        int16_t *_vx, *_vy;
+        int16_t *_life;
+        uint16_t *_fadeStep; // 65536 / lifetime, to work out brightness without a division
+        uint32_t *_color;
+
+        void _update();
+        Vector2D _getOrigin();
+};
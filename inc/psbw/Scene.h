@@ -3,6 +3,7 @@
 #include "psbw/Fudgebundle.h"
 #include "psbw/BWM.h"
 #include "psbw/Camera.h"
+#include "psbw/Collider.h"
 
 typedef enum SceneType {
     SCENE_2D = 0,
@@ -23,23 +24,67 @@ typedef struct GAMEOBJECT_ENTRY {
 class Scene {
     public:
         ~Scene();
-        void loadData();
+        virtual void loadData();
         
         SceneType type = SCENE_2D;
         char* name;
         
         Vector2D *backgroundImage = nullptr;
 
+        /**
+         * \brief Set this in the constructor to render the scene at 640x480 interlaced. Backgrounds are not drawn in this mode and fewer VRAM pages are free for textures
+         */
+        bool highResolution = false;
+
+        /**
+         * \brief Set this to only redraw the parts of the screen where components moved or changed. Worth it for mostly static scenes such as menus
+         */
+        bool partialRedraw = false;
+
         Camera *camera;
+
+        /**
+         * \brief Position in the world shown at the top left corner of the screen in 2D scenes. Components are drawn relative to it unless they're screenSpace, and ones that end up off screen are skipped. Backgrounds don't scroll
+         */
+        Vector2D camera2D = {0, 0};
         
         void addGameObject(GameObject *object);
         GAMEOBJECT_ENTRY _linked_list;
 
+        /**
+         * \brief Adds a collider to the scene's collision checks, which run after every sceneLoop(). Colliders remove themselves when they're deleted
+         */
+        void addCollider(Collider *collider);
+        void removeCollider(Collider *collider);
+        COLLISION_WORLD *_collisions = nullptr;
+
+        /**
+         * \brief Asset getters look names up in the scene's bundle and the common bundle (see psbw_load_common_bundle()). They return objects owned by the bundle, which are valid until it's unloaded. Don't delete them
+         */
         Texture* getTexture(char *name);
+        /**
+         * \brief Returns all frames of a texture for use with AnimatedSprite. Free the array with free() when you're done with it
+         */
+        AnimationFrame* getAnimation(char *name, int *numFrames);
         Sound* getSound(char *name);
         void setBackground(char* name);
         BWM *getMesh(char *name);
 
+        /**
+         * \brief Reads an asset from the CD ahead of time (e.g. at the start of a level) so the first use doesn't stall. Backgrounds and meshes are otherwise read when they're first requested
+         */
+        void prefetch(char *name);
+
+        /**
+         * \brief Same as the functions above but with the name hashed at compile time, e.g. getTexture("font"_fdg). The build checks that these names exist in a bundle
+         */
+        Texture* getTexture(FDG_NAME name);
+        AnimationFrame* getAnimation(FDG_NAME name, int *numFrames);
+        Sound* getSound(FDG_NAME name);
+        void setBackground(FDG_NAME name);
+        BWM *getMesh(FDG_NAME name);
+        void prefetch(FDG_NAME name);
+
         virtual void sceneSetup() = 0;
         virtual void sceneLoop() = 0;
 
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "psbw/Fudgebundle.h"
+#include "psbw/Sound.h"
+
+#define SEQUENCE_CHANNELS 16
+#define SEQUENCE_NO_LOOP 0xffffffff
+
+// Header of a sequence made by tools/convertMidi.py. It's followed by the
+// instruments and then the events, each made of the number of ticks since the
+// previous event (as a MIDI variable-length number), a byte with the event
+// type in the top 4 bits and the channel in the bottom ones, and its
+// parameters.
+typedef struct SEQUENCE_HEADER
+{
+    char magic[4]; // "PSEQ"
+    uint16_t tickRate; // Ticks per second
+    uint8_t numInstruments;
+    uint8_t _reserved;
+    uint32_t loopOffset; // Where playback continues after the end, SEQUENCE_NO_LOOP if it doesn't
+    uint32_t eventsOffset;
+} SEQUENCE_HEADER;
+
+typedef struct SEQUENCE_INSTRUMENT
+{
+    uint32_t sound; // Name hash of a sound in a loaded bundle
+    uint8_t baseNote; // MIDI note the sound plays at its own sample rate
+    uint8_t volume; // 0-127
+    uint16_t adsr1, adsr2; // SPU envelope settings
+    uint16_t _reserved;
+} SEQUENCE_INSTRUMENT;
+
+typedef enum {
+    SEQUENCE_NOTE_OFF = 0x8, // Note
+    SEQUENCE_NOTE_ON = 0x9, // Note, velocity
+    SEQUENCE_PAN = 0xa, // Pan (0-127, 64 is the center)
+    SEQUENCE_VOLUME = 0xb, // Volume (0-127)
+    SEQUENCE_INSTRUMENT_CHANGE = 0xc, // Instrument index
+    SEQUENCE_PITCH_BEND = 0xe, // Signed 16-bit bend in 1/256 semitones
+    SEQUENCE_END = 0xf // Channel bits must be set too (0xff)
+} SEQUENCE_EVENT;
+
+typedef struct SEQUENCER_CHANNEL
+{
+    uint8_t instrument, volume, pan;
+    int16_t bend;
+} SEQUENCER_CHANNEL;
+
+typedef struct SEQUENCER_VOICE
+{
+    uint8_t spuVoice;
+    uint8_t channel, note, velocity;
+    const SEQUENCE_INSTRUMENT *instrument;
+    Sound *sound;
+    bool held; // Between its note on and note off
+    uint32_t age; // When the voice was last keyed on or off
+} SEQUENCER_VOICE;
+
+/**
+ * \class Sequencer
+ * \brief Plays music converted from MIDI with tools/convertMidi.py, using sounds in SPU RAM as instruments. Unlike soundPlayCdda() it keeps the CD free for loading and streaming
+ */
+class Sequencer {
+    public:
+
+        /**
+         * \brief Loads the sequence with the given name and its instruments from the loaded bundles and reserves voices SPU voices for its notes, so sounds played with Sound::play() can't cut them off. Delete it before its bundles are unloaded
+         */
+        Sequencer(FDG_NAME name, int voices = 8);
+        Sequencer(char *name, int voices = 8);
+        ~Sequencer();
+
+        /**
+         * \brief Starts playing from the beginning. Songs converted with a loop point jump back to it at the end unless loop is false
+         */
+        void play(bool loop = true);
+
+        /**
+         * \brief Stops playback, letting the notes playing fade out
+         */
+        void stop();
+
+        /**
+         * \brief Sets the volume of the whole song (0-127)
+         */
+        void setVolume(int volume);
+
+        bool isPlaying();
+
+    private:
+        const SEQUENCE_HEADER *_header;
+        const SEQUENCE_INSTRUMENT *_instruments;
+        Sound **_sounds;
+        const uint8_t *_data;
+        uint32_t _length;
+
+        uint32_t _spuVoices;
+        SEQUENCER_VOICE *_voices;
+        int _numVoices;
+        SEQUENCER_CHANNEL _channels[SEQUENCE_CHANNELS];
+
+        // Playback state, updated from the scheduler's timer interrupt
+        int _task;
+        volatile bool _playing;
+        volatile bool _volumeChanged;
+        bool _loop, _jumped;
+        uint32_t _position;
+        uint32_t _wait; // Ticks until the next event
+        uint32_t _age;
+        uint8_t _volume;
+        uint32_t _keyOn, _keyOff; // Voices to key on and off at the end of the tick
+
+        void _init(uint32_t hash, int voices);
+        static void _tick(void *arg);
+        void _update();
+        bool _readEvent();
+        uint32_t _readNumber();
+        void _noteOn(int channel, int note, int velocity);
+        void _noteOff(int channel, int note);
+        SEQUENCER_VOICE *_allocVoice(int channel, int note);
+        void _setPitch(SEQUENCER_VOICE *voice);
+        void _setVolume(SEQUENCER_VOICE *voice);
+        void _releaseAll();
+};
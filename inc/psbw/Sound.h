@@ -1,10 +1,12 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 
 void spu_init();
 
-void spu_upload(const void *data, size_t size);
+/// @brief Uploads raw data to the given address in SPU RAM
+void spu_upload(uint32_t addr, const void *data, size_t size);
 
 /// @brief Plays an audio track from the CDROM
 void soundPlayCdda(int track, int loop);
@@ -14,6 +16,12 @@ void soundStopCdda();
 
 void spu_play_sample(int addr, int sample_rate);
 
+/// @brief Reserves count voices (taken from the last one down) so Sound::play() never picks them. Returns a bitmask of the voices, or 0 if not enough are free
+uint32_t spu_reserve_voices(int count);
+
+/// @brief Gives voices reserved by spu_reserve_voices() back
+void spu_release_voices(uint32_t voices);
+
 /**
  * \class Sound
  * \brief A single sound file whhich can be played
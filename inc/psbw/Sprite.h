@@ -38,6 +38,9 @@ class Sprite : public Component {
          * \brief Do not use - Handled by engine
          */
         void execute(GameObject* parent) override;
+        bool getBounds(GameObject* parent, Rect* bounds) override;
+        uint32_t getStateHash() override;
     
     private:
+        bool _getScreenBounds(GameObject* parent, Rect* bounds);
 };
\ No newline at end of file
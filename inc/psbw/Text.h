@@ -11,6 +11,8 @@ class Text : public Component {
         char* text;
         int zIndex = 0;
         void execute(GameObject* parent) override;
+        bool getBounds(GameObject* parent, Rect* bounds) override;
+        uint32_t getStateHash() override;
         void setFont(Font* font);
     private:
         Font* _fnt;
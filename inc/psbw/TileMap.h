@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "psbw/Component.h"
+#include "psbw/Fudgebundle.h"
+#include "psbw/Vector.h"
+
+#define TILE_SIZE 16
+#define TILEMAP_CHUNK_TILES 32 // Chunks are 32x32 tiles, which is one sector of tile indices
+#define TILEMAP_WINDOW 3 // Chunks kept loaded around the camera in each direction (3x3)
+
+// Header of a tile map made by tools/convertTilemap.py. The header takes up
+// the first 2048 bytes, followed by the chunks in rows and the tile graphics.
+typedef struct TILEMAP_HEADER
+{
+    char magic[4]; // "TMAP"
+    uint16_t width, height; // In tiles
+    uint16_t chunksWide, chunksHigh;
+    uint16_t numTiles; // Tiles in the tileset, not counting the empty tile 0
+    uint16_t _reserved;
+    uint32_t tilesOffset; // Offset of the tile graphics, 16x16 15bpp each
+} TILEMAP_HEADER;
+
+typedef struct TILEMAP_CHUNK
+{
+    int16_t x, y; // Chunk coordinates, -1 if the slot is empty
+    bool ready;
+    uint16_t tiles[TILEMAP_CHUNK_TILES * TILEMAP_CHUNK_TILES];
+} TILEMAP_CHUNK;
+
+/**
+ * \class TileMap
+ * \brief Add this component to a GameObject to draw a tile map of any size, streamed from the CD around the scene's camera2D. It starts at the GameObject's position
+ */
+class TileMap : public Component {
+    public:
+
+        /**
+         * \brief Streams the tile map with the given name from a loaded bundle, which must not be compressed. Tile graphics are kept in cachePages (1-4) VRAM pages, each holding 64 tiles. A 320x240 screen can show up to 21x16 tiles, so maps that show more than 64 * cachePages different tiles at once keep reloading the ones that don't fit and leave them missing
+         */
+        TileMap(FDG_NAME name, int cachePages = 2);
+        ~TileMap();
+
+        /**
+         * \brief Returns the tile index at the given tile coordinates or 0 if it's empty or not loaded yet. Use it for collisions
+         */
+        int getTile(int x, int y);
+
+        /**
+         * \brief Returns true once everything visible has been loaded
+         */
+        bool isReady();
+
+        /**
+         * \brief Waits for the CD read in progress, if any. Call this before reading anything else from the CD (e.g. switching backgrounds) while a tile map is streaming
+         */
+        void sync();
+
+        int getWidth();
+        int getHeight();
+
+        int zIndex = 0;
+
+        /**
+         * \brief Do not use - Handled by engine
+         */
+        void execute(GameObject* parent) override;
+
+    private:
+        TILEMAP_HEADER _header;
+        bool _valid;
+
+        int _lba;
+        uint32_t _offset; // Offset of the tile map into its first sector
+
+        // Chunks are mapped to slots by their coordinates modulo the window
+        // size, so the chunks around the camera never share a slot.
+        TILEMAP_CHUNK _chunks[TILEMAP_WINDOW * TILEMAP_WINDOW];
+        int _centerX, _centerY;
+
+        // Tile graphics in VRAM. Each slot is a 16x16 area of the cache's
+        // texpage.
+        int _page, _numPages;
+        uint16_t _texpage;
+        int _numSlots;
+        uint16_t *_tileSlots; // Slot of each tile, or TILEMAP_NO_SLOT
+        uint16_t *_slotTiles; // Tile in each slot, or TILEMAP_NO_SLOT
+        uint32_t *_slotUsed; // Frame each slot was last drawn in
+        uint32_t *_wanted; // Bitmap of tiles that are needed but not in VRAM
+        uint32_t _frame;
+
+        // Read in progress. Reads cover two sectors, as the tile map doesn't
+        // have to start at a sector boundary.
+        uint32_t *_buffer;
+        bool _reading;
+        TILEMAP_CHUNK *_readChunk; // nullptr when reading tile graphics
+        int _readGroup;
+
+        bool _startRead(uint32_t offset);
+        void _finishRead(bool ok);
+        void _requestNext();
+        void _want(int tile);
+        int _allocSlot();
+        TILEMAP_CHUNK *_getChunk(int x, int y);
+};
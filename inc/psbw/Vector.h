@@ -10,4 +10,11 @@ typedef struct {
     int x;
     int y;
     int z;
-} Vector3D;
\ No newline at end of file
+} Vector3D;
+
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+} Rect;
\ No newline at end of file
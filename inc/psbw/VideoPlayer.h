@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+
+#include "psbw/Scene.h"
+
+struct CdlStreamSector;
+
+/**
+ * \class VideoPlayer
+ * \brief A Scene that plays a video converted with tools/convertVideo.py (and its interleaved XA audio) from the CD, then loads the next scene
+ */
+class VideoPlayer : public Scene {
+    public:
+        /**
+         * \brief Plays the given file (e.g. "\\INTRO.STR;1") and loads next once it ends or stop() is called. The video player deletes itself, so don't keep the pointer around
+         */
+        VideoPlayer(char *filename, Scene *next);
+
+        /**
+         * \brief Ends playback early (e.g. when a button is pressed) and loads the next scene. Call this instead of loading another scene directly
+         */
+        void stop();
+
+        /**
+         * \brief Returns the frame being shown, counting from 0
+         */
+        int getFrame();
+
+        void loadData() override;
+        void sceneSetup() override;
+        void sceneLoop() override;
+
+    private:
+        Scene *_next;
+        bool _playing;
+
+        CdlStreamSector *_ring;
+
+        // Frames are decoded into the back buffer, which becomes the scene's
+        // background once it's time to show it.
+        Vector2D _buffers[2];
+        int _pages;
+        int _back;
+        bool _back_ready;
+
+        // Frame being assembled from its sectors
+        uint8_t *_frame;
+        uint32_t _frame_size;
+        int _frame_number, _frame_chunks;
+
+        int _shown, _ready_frame;
+        int _fps;
+        uint32_t _start_tick;
+        uint16_t _old_cd_volume[2];
+
+        bool _receive(const uint32_t *data);
+        void _finish();
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+
+#define SCHEDULER_MAX_TASKS 8
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*SchedulerTask)(void *arg);
+
+// Timings are in units of timer 2, which counts every 8 CPU cycles
+// (about 0.24 us).
+typedef struct SCHEDULER_STATS {
+    uint32_t ticks; // Timer interrupts handled
+    uint32_t overruns; // Ticks where the tasks were still running when the next one was due
+    uint16_t lastLatency, maxLatency; // Time between the timer firing and the first task starting
+} SCHEDULER_STATS;
+
+typedef struct SCHEDULER_TASK_STATS {
+    uint32_t runs;
+    uint16_t lastTime, maxTime;
+} SCHEDULER_TASK_STATS;
+
+// Sets up timer 2 to fire SCHEDULER_RATE times per second. DO NOT RUN FROM GAME CODE. Managed by engine.
+void scheduler_init();
+
+/**
+ * \brief Runs task rate times per second (up to SCHEDULER_RATE) from the timer interrupt, regardless of the frame rate. Tasks
+ * run with interrupts disabled, so they must be short and can't wait for anything (e.g. CD reads or VSync()). Returns a
+ * handle for the other functions or -1 if there are already SCHEDULER_MAX_TASKS tasks
+ */
+int scheduler_add_task(SchedulerTask task, void *arg, int rate);
+void scheduler_remove_task(int handle);
+
+const SCHEDULER_TASK_STATS *scheduler_get_task_stats(int handle);
+const SCHEDULER_STATS *scheduler_get_stats();
+void scheduler_reset_stats();
+
+#ifdef __cplusplus
+}
+#endif
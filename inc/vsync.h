@@ -1,5 +1,9 @@
 #pragma once
 
+#include <stdbool.h>
+
+#define VSYNC_MAX_IDLE_TASKS 8
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -9,6 +13,16 @@ void vsync_init();
 
 int VSync(int mode);
 
+// Does a small amount of work and returns true once there's none left
+typedef bool (*IdleTask)(void *arg);
+
+/**
+ * \brief Runs task over and over while VSync() waits for the vblank, until it returns true. Each call should take well under a
+ * millisecond, as calls are only started when at least that much of the frame is left. Returns false if the queue is full
+ */
+bool vsync_add_idle_task(IdleTask task, void *arg);
+void vsync_remove_idle_task(IdleTask task, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,195 @@
+# ps1-bare-metal - (C) 2023 spicyjpeg
+#
+# Permission to use, copy, modify, and/or distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+# REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+# AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+# INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+# LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+# OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+# PERFORMANCE OF THIS SOFTWARE.
+
+.set noreorder
+
+# These are optimized implementations of memcpy() and memmove() that align the
+# destination pointer to a word boundary and then copy 32 bits at a time. If
+# the source pointer is not aligned as well, each word is fetched using an
+# lwr/lwl pair (which can be issued back-to-back without a load delay slot in
+# between) so the stores are always aligned.
+
+.section .text.memcpy, "ax", @progbits
+.global memcpy
+.type memcpy, @function
+
+memcpy:
+	# Copies shorter than 16 bytes are not worth aligning, so they are done one
+	# byte at a time by the loop at the end.
+	sltiu $t0, $a2, 16
+	bnez  $t0, .LcopyBytes
+	move  $v0, $a0 # returnValue = dest
+
+	# Copy the first 0-3 bytes to align dest and update count accordingly.
+	negu  $t0, $a0 # align = (4 - (dest % 4)) % 4
+	andi  $t0, 3
+	beqz  $t0, .LdestAligned
+	subu  $a2, $t0 # count -= align
+
+.LalignLoop:
+	lbu   $t1, 0($a1)
+	addiu $t0, -1
+	addiu $a1, 1
+	sb    $t1, 0($a0)
+	bnez  $t0, .LalignLoop
+	addiu $a0, 1
+
+.LdestAligned:
+	# Split the remaining data into 16-byte blocks, which are copied by one of
+	# the two unrolled loops below depending on whether src is also aligned.
+	andi  $t2, $a2, 15 # remainder = count % 16
+	subu  $t3, $a2, $t2
+	addu  $t3, $a1 # blockEnd = src + (count - remainder)
+	andi  $t0, $a1, 3
+	bnez  $t0, .LunalignedBlocks
+	move  $a2, $t2 # count = remainder
+
+	beq   $a1, $t3, .LcopyWords
+	nop
+
+.LalignedBlockLoop:
+	lw    $t4, 0x0($a1)
+	lw    $t5, 0x4($a1)
+	lw    $t6, 0x8($a1)
+	lw    $t7, 0xc($a1)
+	addiu $a1, 16
+	sw    $t4, 0x0($a0)
+	sw    $t5, 0x4($a0)
+	sw    $t6, 0x8($a0)
+	addiu $a0, 16
+	bne   $a1, $t3, .LalignedBlockLoop
+	sw    $t7, -0x4($a0)
+
+	b     .LcopyWords
+	nop
+
+.LunalignedBlocks:
+	beq   $a1, $t3, .LcopyWords
+	nop
+
+.LunalignedBlockLoop:
+	lwr   $t4, 0x0($a1)
+	lwl   $t4, 0x3($a1)
+	lwr   $t5, 0x4($a1)
+	lwl   $t5, 0x7($a1)
+	lwr   $t6, 0x8($a1)
+	lwl   $t6, 0xb($a1)
+	lwr   $t7, 0xc($a1)
+	lwl   $t7, 0xf($a1)
+	addiu $a1, 16
+	sw    $t4, 0x0($a0)
+	sw    $t5, 0x4($a0)
+	sw    $t6, 0x8($a0)
+	addiu $a0, 16
+	bne   $a1, $t3, .LunalignedBlockLoop
+	sw    $t7, -0x4($a0)
+
+.LcopyWords:
+	# Copy any remaining whole words. Using lwr/lwl here works regardless of
+	# the alignment of src and saves a branch.
+	andi  $t2, $a2, 3 # remainder = count % 4
+	subu  $t3, $a2, $t2
+	addu  $t3, $a1 # wordEnd = src + (count - remainder)
+	beq   $a1, $t3, .LcopyBytes
+	move  $a2, $t2 # count = remainder
+
+.LwordLoop:
+	lwr   $t4, 0($a1)
+	lwl   $t4, 3($a1)
+	addiu $a1, 4
+	addiu $a0, 4
+	bne   $a1, $t3, .LwordLoop
+	sw    $t4, -4($a0)
+
+.LcopyBytes:
+	beqz  $a2, .Lreturn
+	addu  $t3, $a1, $a2 # end = src + count
+
+.LbyteLoop:
+	lbu   $t4, 0($a1)
+	addiu $a1, 1
+	addiu $a0, 1
+	bne   $a1, $t3, .LbyteLoop
+	sb    $t4, -1($a0)
+
+.Lreturn:
+	jr    $ra
+	nop
+
+.section .text.memmove, "ax", @progbits
+.global memmove
+.type memmove, @function
+
+memmove:
+	# Copying forwards is safe (memcpy() always reads a block before writing
+	# it) unless the destination starts within the source buffer.
+	sltu  $t0, $a1, $a0 # if (src >= dest) return memcpy(dest, src, count)
+	beqz  $t0, .LforwardCopy
+	addu  $t1, $a1, $a2 # srcEnd = src + count
+	sltu  $t0, $a0, $t1 # if (dest < srcEnd) copy backwards
+	bnez  $t0, .LbackwardCopy
+	addu  $t2, $a0, $a2 # destEnd = dest + count
+
+.LforwardCopy:
+	j     memcpy
+	nop
+
+.LbackwardCopy:
+	# Same as memcpy(), but starting from the end of both buffers and aligning
+	# destEnd rather than dest.
+	sltiu $t0, $a2, 16
+	bnez  $t0, .LbackBytes
+	move  $v0, $a0 # returnValue = dest
+
+	andi  $t0, $t2, 3 # align = destEnd % 4
+	beqz  $t0, .LbackAligned
+	subu  $a2, $t0 # count -= align
+
+.LbackAlignLoop:
+	lbu   $t3, -1($t1)
+	addiu $t0, -1
+	addiu $t1, -1
+	sb    $t3, -1($t2)
+	bnez  $t0, .LbackAlignLoop
+	addiu $t2, -1
+
+.LbackAligned:
+	andi  $t4, $a2, 3 # remainder = count % 4
+	subu  $t3, $a2, $t4
+	subu  $t3, $t1, $t3 # wordStart = srcEnd - (count - remainder)
+	beq   $t1, $t3, .LbackBytes
+	move  $a2, $t4 # count = remainder
+
+.LbackWordLoop:
+	lwr   $t5, -4($t1)
+	lwl   $t5, -1($t1)
+	addiu $t1, -4
+	addiu $t2, -4
+	bne   $t1, $t3, .LbackWordLoop
+	sw    $t5, 0($t2)
+
+.LbackBytes:
+	beqz  $a2, .LbackReturn
+	subu  $t3, $t1, $a2 # start = srcEnd - count
+
+.LbackByteLoop:
+	lbu   $t5, -1($t1)
+	addiu $t1, -1
+	addiu $t2, -1
+	bne   $t1, $t3, .LbackByteLoop
+	sb    $t5, 0($t2)
+
+.LbackReturn:
+	jr    $ra
+	nop
@@ -62,6 +62,11 @@ int toupper(int ch) {
 
 /* Memory buffer manipulation */
 
+// memset(), memcpy() and memmove() are implemented in assembly (see memset.s
+// and memcpy.s).
+
+typedef uint32_t __attribute__((may_alias)) Word;
+
 #if 0
 void *memset(void *dest, int ch, size_t count) {
 	uint8_t *_dest = (uint8_t *) dest;
@@ -71,7 +76,6 @@ void *memset(void *dest, int ch, size_t count) {
 
 	return dest;
 }
-#endif
 
 void *memcpy(void *restrict dest, const void *restrict src, size_t count) {
 	uint8_t       *_dest = (uint8_t *) dest;
@@ -82,6 +86,7 @@ void *memcpy(void *restrict dest, const void *restrict src, size_t count) {
 
 	return dest;
 }
+#endif
 
 void *memccpy(void *restrict dest, const void *restrict src, int ch, size_t count) {
 	uint8_t       *_dest = (uint8_t *) dest;
@@ -98,6 +103,7 @@ void *memccpy(void *restrict dest, const void *restrict src, int ch, size_t coun
 	return 0;
 }
 
+#if 0
 void *memmove(void *dest, const void *src, size_t count) {
 	uint8_t       *_dest = (uint8_t *) dest;
 	const uint8_t *_src  = (const uint8_t *) src;
@@ -120,11 +126,29 @@ void *memmove(void *dest, const void *src, size_t count) {
 
 	return dest;
 }
+#endif
 
 int memcmp(const void *lhs, const void *rhs, size_t count) {
 	const uint8_t *_lhs = (const uint8_t *) lhs;
 	const uint8_t *_rhs = (const uint8_t *) rhs;
 
+	// If both buffers have the same alignment, skip over identical words
+	// before falling back to the byte loop (which will then locate the first
+	// mismatching byte, if any).
+	if (!(((uint32_t) _lhs ^ (uint32_t) _rhs) & 3)) {
+		for (; count && ((uint32_t) _lhs & 3); count--) {
+			uint8_t a = *(_lhs++), b = *(_rhs++);
+
+			if (a != b)
+				return a - b;
+		}
+
+		for (; count >= 4; count -= 4, _lhs += 4, _rhs += 4) {
+			if (*((const Word *) _lhs) != *((const Word *) _rhs))
+				break;
+		}
+	}
+
 	for (; count; count--) {
 		uint8_t a = *(_lhs++), b = *(_rhs++);
 
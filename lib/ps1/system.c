@@ -144,7 +144,7 @@ bool waitForInterrupt(IRQChannel irq, int timeout)
 		if (acknowledgeInterrupt(irq))
 			return true;
 
-		delayMicroseconds(10);
+		delayMicrosecondsBusy(10);
 	}
 
 	return false;
@@ -157,7 +157,7 @@ bool waitForDMATransfer(DMAChannel dma, int timeout)
 		if (!(DMA_CHCR(dma) & DMA_CHCR_ENABLE))
 			return true;
 
-		delayMicroseconds(10);
+		delayMicrosecondsBusy(10);
 	}
 
 	return false;
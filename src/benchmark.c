@@ -0,0 +1,144 @@
+#include "benchmark.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <ps1/registers.h>
+#include <ps1/system.h>
+#include <vendor/printf.h>
+
+#define BENCHMARK_RUNS 8
+#define BENCHMARK_MAX_SIZE 1024
+
+// Timer 1 counts hblanks (see vsync_init()). A line is about 2150 cycles, so
+// a call taking this many lines might have wrapped the 16-bit timer 0 around.
+#define BENCHMARK_MAX_LINES 28
+#define BENCHMARK_TOO_SLOW 0xffffffff
+
+typedef enum {
+    BENCHMARK_MEMCPY,
+    BENCHMARK_MEMCPY_UNALIGNED,
+    BENCHMARK_MEMMOVE_BACKWARDS,
+    BENCHMARK_MEMCMP
+} BENCHMARK_TEST;
+
+static const char *const _test_names[] = {
+    "memcpy", "memcpy (unaligned)", "memmove (overlapping)", "memcmp"
+};
+
+// Each call is timed on its own with the 16-bit timer, so the largest size
+// has to stay well below 65536 cycles even for the byte loops at -O0
+static const int _sizes[] = { 4, 16, 64, 256, BENCHMARK_MAX_SIZE };
+
+static uint8_t _src[BENCHMARK_MAX_SIZE + 8] __attribute__((aligned(4)));
+static uint8_t _dest[BENCHMARK_MAX_SIZE + 8] __attribute__((aligned(4)));
+
+// The byte loops the assembly versions replaced. GCC would otherwise turn
+// them back into calls to the functions being measured.
+#define BYTE_LOOP __attribute__((noinline, optimize("no-tree-loop-distribute-patterns")))
+
+BYTE_LOOP static void _byte_copy(uint8_t *dest, const uint8_t *src, size_t count) {
+    for (; count; count--)
+        *(dest++) = *(src++);
+}
+
+BYTE_LOOP static void _byte_copy_backwards(uint8_t *dest, const uint8_t *src, size_t count) {
+    src += count;
+    dest += count;
+
+    for (; count; count--)
+        *(--dest) = *(--src);
+}
+
+BYTE_LOOP static int _byte_compare(const uint8_t *lhs, const uint8_t *rhs, size_t count) {
+    for (; count; count--, lhs++, rhs++) {
+        if (*lhs != *rhs)
+            return *lhs - *rhs;
+    }
+
+    return 0;
+}
+
+// Returns the fewest cycles out of BENCHMARK_RUNS calls, which leaves out the
+// first run filling the instruction cache, or BENCHMARK_TOO_SLOW if every
+// call took too long for timer 0 to measure
+static uint32_t _run(BENCHMARK_TEST test, bool reference, int size) {
+    uint32_t best = BENCHMARK_TOO_SLOW;
+
+    for (int i = 0; i < BENCHMARK_RUNS; i++) {
+        bool enable = disableInterrupts();
+        uint16_t startLine = TIMER_VALUE(1);
+        uint16_t start = TIMER_VALUE(0);
+
+        switch (test) {
+            case BENCHMARK_MEMCPY:
+                if (reference)
+                    _byte_copy(_dest, _src, size);
+                else
+                    memcpy(_dest, _src, size);
+                break;
+
+            case BENCHMARK_MEMCPY_UNALIGNED:
+                if (reference)
+                    _byte_copy(_dest, &_src[1], size);
+                else
+                    memcpy(_dest, &_src[1], size);
+                break;
+
+            case BENCHMARK_MEMMOVE_BACKWARDS:
+                if (reference)
+                    _byte_copy_backwards(&_src[4], _src, size);
+                else
+                    memmove(&_src[4], _src, size);
+                break;
+
+            case BENCHMARK_MEMCMP:
+                if (reference)
+                    _byte_compare(_dest, _src, size);
+                else
+                    memcmp(_dest, _src, size);
+                break;
+        }
+
+        uint16_t cycles = TIMER_VALUE(0) - start;
+        uint16_t lines = TIMER_VALUE(1) - startLine;
+        if (enable)
+            enableInterrupts();
+
+        if (lines < BENCHMARK_MAX_LINES && cycles < best)
+            best = cycles;
+    }
+
+    return best;
+}
+
+void benchmark_memory() {
+    printf("Memory benchmark, CPU cycles per call (byte loop / libc)\n");
+
+    for (int test = BENCHMARK_MEMCPY; test <= BENCHMARK_MEMCMP; test++) {
+        printf("%s:\n", _test_names[test]);
+
+        for (int i = 0; i < (int) (sizeof(_sizes) / sizeof(_sizes[0])); i++) {
+            // memcmp() has to get through the whole buffer, so both sides
+            // must be equal
+            for (int j = 0; j < (int) sizeof(_src); j++)
+                _src[j] = _dest[j] = (uint8_t) j;
+
+            uint32_t reference = _run((BENCHMARK_TEST) test, true, _sizes[i]);
+            uint32_t libc = _run((BENCHMARK_TEST) test, false, _sizes[i]);
+
+            if (reference == BENCHMARK_TOO_SLOW || libc == BENCHMARK_TOO_SLOW) {
+                printf("  %4d bytes: too slow to time\n", _sizes[i]);
+                continue;
+            }
+
+            uint32_t speedup = libc ? reference * 100 / libc : 0;
+
+            printf(
+                "  %4d bytes: %5d / %5d (%d.%02dx)\n", _sizes[i], reference, libc,
+                speedup / 100, speedup % 100
+            );
+        }
+    }
+}
@@ -153,7 +153,7 @@ void card_read(uint8_t card, uint16_t sectorNumber, uint8_t *data)
 	VSync(10);
 	sio0_port_select(0);
 	SIO_CTRL(0) |= SIO_CTRL_DTR | SIO_CTRL_ACKNOWLEDGE;
-	delayMicroseconds(60);
+	delayMicrosecondsBusy(60);
 
 	SIO_DATA(0) = 0x81;
 	if (!sio0_wait_acknowledge(1200))
@@ -204,7 +204,7 @@ void card_write(uint8_t card, uint16_t sectorNumber, uint8_t *data)
 	VSync(10);
 	sio0_port_select(0);
 	SIO_CTRL(0) |= SIO_CTRL_DTR | SIO_CTRL_ACKNOWLEDGE;
-	delayMicroseconds(60);
+	delayMicrosecondsBusy(60);
 
 	SIO_DATA(0) = 0x81;
 	if (!sio0_wait_acknowledge(1200))
@@ -25,9 +25,13 @@
 
 static CdlCB _read_callback = (CdlCB) 0;
 
-static int     _total_sectors, _sector_size;
+static int     _total_sectors, _sector_size, _form2;
 static uint8_t _read_result[4];
 
+// Header and subheader before the payload of a sector and EDC after it, which
+// are thrown away when reading Form 2 sectors.
+static uint32_t _discarded[3];
+
 static volatile uint32_t *_read_addr;
 static volatile int      _read_timeout, _pending_attempts, _pending_sectors;
 
@@ -37,7 +41,13 @@ extern CdlCB _cd_override_callback;
 
 static void _sector_callback(CdlIntrResult irq, uint8_t *result) {
 	if (irq == CdlDataReady) {
-		CdGetSector((void *) _read_addr, _sector_size);
+		if (_form2) {
+			CdGetSector(_discarded, 3);
+			CdGetSector((void *) _read_addr, _sector_size);
+			CdGetSector(_discarded, 1);
+		} else {
+			CdGetSector((void *) _read_addr, _sector_size);
+		}
 		_read_addr += _sector_size;
 
 		if (--_pending_sectors > 0) {
@@ -104,7 +114,14 @@ int CdReadRetry(int sectors, uint32_t *buf, int mode, int attempts) {
 	_pending_attempts = attempts - 1;
 	_pending_sectors  = sectors;
 	_total_sectors    = sectors;
-	_sector_size      = (mode & CdlModeSize) ? 585 : 512;
+	_form2            = (mode & CdlModeForm2) != 0;
+
+	if (_form2) {
+		mode        |= CdlModeSize;
+		_sector_size = CD_FORM2_PAYLOAD / 4;
+	} else {
+		_sector_size = (mode & CdlModeSize) ? 585 : 512;
+	}
 
 	disableInterrupts();
 	_cd_override_callback = &_sector_callback;
@@ -0,0 +1,164 @@
+/*
+ * Sector streaming API
+ *
+ * Reads sectors in the background into a ring buffer of CdlStreamSector
+ * slots, keeping each sector's header and subheader but storing its payload
+ * without them. Used for data that is consumed while it's being read (video,
+ * audio and other bulk data), which is usually stored as Mode 2 Form 2 sectors
+ * for their larger payload.
+ */
+
+#include "cdstream.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "cdrom.h"
+#include "interrupts.h"
+#include "vsync.h"
+
+#define CD_STREAM_COOLDOWN	2
+
+// Number of 32-bit words in a sector read with CdlModeSize set
+#define RAW_SECTOR_WORDS	(2340 / 4)
+#define HEADER_WORDS		(sizeof(CdlLOCINFOL) / 4 + 1)
+
+/* Internal globals */
+
+static CdlStreamSector *_ring;
+static int             _slots;
+static uint8_t         _mode;
+static CdlCB           _old_ready_callback;
+
+static volatile int _head, _tail, _count;
+static volatile int _remaining, _next_lba, _paused, _error, _resume_time;
+
+// EDC and ECC after the payload of a sector, which are thrown away.
+static uint32_t _discarded[RAW_SECTOR_WORDS - HEADER_WORDS - CD_FORM1_PAYLOAD / 4];
+
+/* Private utilities and sector callback */
+
+static void _pause(void) {
+	CdCommandF(CdlPause, 0, 0);
+
+	// The drive ignores commands for a while after pausing.
+	_paused      = 1;
+	_resume_time = VSync(-1) + CD_STREAM_COOLDOWN;
+}
+
+static void _stream_callback(CdlIntrResult irq, uint8_t *result) {
+	if (irq != CdlDataReady) {
+		_error = 1;
+		_pause();
+		return;
+	}
+
+	// If the ring buffer is full this sector is dropped and read again once
+	// reading resumes.
+	if (_paused || !_remaining || (_count == _slots)) {
+		if (!_paused)
+			_pause();
+		return;
+	}
+
+	CdlStreamSector *sector = &_ring[_head];
+	CdGetSector(sector, HEADER_WORDS);
+
+	int words = CdStreamGetLength(sector) / 4;
+	CdGetSector(sector->data, words);
+	CdGetSector(_discarded, RAW_SECTOR_WORDS - HEADER_WORDS - words);
+
+	if (++_head == _slots)
+		_head = 0;
+
+	_count++;
+	_next_lba++;
+
+	if (!--_remaining || (sector->info.submode & CdlSubmodeEOF)) {
+		_remaining = 0;
+		_pause();
+	}
+}
+
+static int _resume(void) {
+	CdlLOC pos;
+	CdIntToPos(_next_lba, &pos);
+
+	_paused = 0;
+
+	if (!CdCommand(CdlSetloc, (const uint8_t *) &pos, 3, 0))
+		return 0;
+	if (!CdCommand(CdlReadS, 0, 0, 0))
+		return 0;
+
+	return 1;
+}
+
+/* Public API */
+
+int CdStreamStart(const CdlLOC *pos, int sectors, CdlStreamSector *ring, int slots, int mode) {
+	_ring      = ring;
+	_slots     = slots;
+	_mode      = mode | CdlModeSize;
+	_head      = 0;
+	_tail      = 0;
+	_count     = 0;
+	_remaining = sectors;
+	_next_lba  = CdPosToInt(pos);
+	_error     = 0;
+
+	_old_ready_callback = CdReadyCallback(&_stream_callback);
+
+	if (!CdCommand(CdlSetmode, &_mode, 1, 0))
+		return 0;
+
+	return _resume();
+}
+
+CdlStreamSector *CdStreamGetSector(void) {
+	if (!_count)
+		return 0;
+
+	return &_ring[_tail];
+}
+
+void CdStreamRelease(void) {
+	if (!_count)
+		return;
+
+	if (++_tail == _slots)
+		_tail = 0;
+
+	disableInterrupts();
+	_count--;
+	enableInterrupts();
+}
+
+int CdStreamSync(void) {
+	if (_error)
+		return -1;
+
+	if (
+		_paused && _remaining && (_count <= _slots / 2) &&
+		(VSync(-1) >= _resume_time)
+	) {
+		if (!_resume()) {
+			printf("CdStream failed to resume at sector %d\n", _next_lba);
+			_error = 1;
+			return -1;
+		}
+	}
+
+	return _remaining + _count;
+}
+
+void CdStreamStop(void) {
+	disableInterrupts();
+	_remaining = 0;
+	enableInterrupts();
+
+	if (!_paused)
+		_pause();
+
+	CdReadyCallback(_old_ready_callback);
+}
@@ -0,0 +1,205 @@
+#include "collision.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+static_assert(!(COLLISION_CELL_SIZE & (COLLISION_CELL_SIZE - 1)), "COLLISION_CELL_SIZE must be a power of two");
+
+// Shifting rather than dividing rounds negative coordinates down as well
+#define CELL_SHIFT __builtin_ctz(COLLISION_CELL_SIZE)
+#define HASH_BITS 8
+
+// One per cell a collider covers. Nodes are in two lists: the bucket of their
+// cell, which is doubly linked so they can be unlinked without searching it,
+// and the list of their collider's cells.
+struct COLLISION_NODE {
+    Collider *collider;
+    int16_t cellX, cellY;
+    COLLISION_NODE *next;
+    COLLISION_NODE **prev;
+    COLLISION_NODE *nextOwn;
+};
+
+struct COLLISION_WORLD {
+    COLLISION_NODE *buckets[1 << HASH_BITS];
+    Collider *colliders;
+    COLLISION_NODE *freeNodes;
+};
+
+static inline int _hash(int x, int y) {
+    return ((uint32_t) x * 0x9e3779b1 ^ (uint32_t) y * 0x85ebca6b) >> (32 - HASH_BITS);
+}
+
+static void _unplace(COLLISION_WORLD *world, Collider *collider) {
+    COLLISION_NODE *node = collider->_nodes;
+
+    while (node != nullptr) {
+        COLLISION_NODE *nextOwn = node->nextOwn;
+
+        *node->prev = node->next;
+        if (node->next != nullptr)
+            node->next->prev = node->prev;
+
+        node->nextOwn = world->freeNodes;
+        world->freeNodes = node;
+        node = nextOwn;
+    }
+
+    collider->_nodes = nullptr;
+}
+
+// Puts the collider in the buckets of the cells it covers, unless it's still
+// in the same ones as last time, which is the common case
+static void _place(COLLISION_WORLD *world, Collider *collider) {
+    Rect rect = collider->getRect();
+    if (rect.width <= 0 || rect.height <= 0) {
+        _unplace(world, collider);
+        return;
+    }
+
+    int x0 = rect.x >> CELL_SHIFT, x1 = (rect.x + rect.width - 1) >> CELL_SHIFT;
+    int y0 = rect.y >> CELL_SHIFT, y1 = (rect.y + rect.height - 1) >> CELL_SHIFT;
+
+    if (
+        collider->_nodes != nullptr &&
+        x0 == collider->_cellX0 && y0 == collider->_cellY0 &&
+        x1 == collider->_cellX1 && y1 == collider->_cellY1
+    )
+        return;
+
+    _unplace(world, collider);
+
+    collider->_cellX0 = x0;
+    collider->_cellY0 = y0;
+    collider->_cellX1 = x1;
+    collider->_cellY1 = y1;
+
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            COLLISION_NODE *node = world->freeNodes;
+            if (node != nullptr)
+                world->freeNodes = node->nextOwn;
+            else
+                node = (COLLISION_NODE *) malloc(sizeof(COLLISION_NODE));
+
+            if (node == nullptr)
+                return;
+
+            COLLISION_NODE **bucket = &world->buckets[_hash(x, y)];
+
+            node->collider = collider;
+            node->cellX = x;
+            node->cellY = y;
+            node->next = *bucket;
+            node->prev = bucket;
+            if (*bucket != nullptr)
+                (*bucket)->prev = &node->next;
+            *bucket = node;
+
+            node->nextOwn = collider->_nodes;
+            collider->_nodes = node;
+        }
+    }
+}
+
+COLLISION_WORLD *collision_create_world() {
+    return (COLLISION_WORLD *) calloc(1, sizeof(COLLISION_WORLD));
+}
+
+void collision_destroy_world(COLLISION_WORLD *world) {
+    if (world == nullptr)
+        return;
+
+    while (world->colliders != nullptr)
+        collision_remove(world->colliders);
+
+    while (world->freeNodes != nullptr) {
+        COLLISION_NODE *node = world->freeNodes;
+        world->freeNodes = node->nextOwn;
+        free(node);
+    }
+
+    free(world);
+}
+
+void collision_add(COLLISION_WORLD *world, Collider *collider) {
+    if (collider->_world != nullptr)
+        collision_remove(collider);
+
+    collider->_world = world;
+    collider->_next = world->colliders;
+    world->colliders = collider;
+
+    _place(world, collider);
+}
+
+void collision_remove(Collider *collider) {
+    COLLISION_WORLD *world = collider->_world;
+    if (world == nullptr)
+        return;
+
+    _unplace(world, collider);
+
+    Collider **link = &world->colliders;
+    while (*link != collider)
+        link = &(*link)->_next;
+    *link = collider->_next;
+
+    collider->_world = nullptr;
+    collider->_next = nullptr;
+}
+
+void collision_update(COLLISION_WORLD *world) {
+    if (world == nullptr)
+        return;
+
+    // Static colliders were placed when they were added and never move
+    for (Collider *collider = world->colliders; collider != nullptr; collider = collider->_next) {
+        if (!collider->isStatic)
+            _place(world, collider);
+    }
+
+    // Pairs are found from the moving collider's side, as two static ones are
+    // never tested. When both move, only the one at the lower address reports.
+    for (Collider *a = world->colliders; a != nullptr; a = a->_next) {
+        if (a->isStatic || !a->enabled)
+            continue;
+
+        Rect rectA = a->getRect();
+
+        for (COLLISION_NODE *own = a->_nodes; own != nullptr; own = own->nextOwn) {
+            for (COLLISION_NODE *node = world->buckets[_hash(own->cellX, own->cellY)]; node != nullptr; node = node->next) {
+                Collider *b = node->collider;
+
+                // Buckets are shared by any cells with the same hash
+                if (node->cellX != own->cellX || node->cellY != own->cellY)
+                    continue;
+                if (b == a || !b->enabled || (!b->isStatic && b < a))
+                    continue;
+                if (!(a->layer & b->mask) || !(b->layer & a->mask))
+                    continue;
+
+                Rect rectB = b->getRect();
+
+                int left = (rectA.x > rectB.x) ? rectA.x : rectB.x;
+                int top = (rectA.y > rectB.y) ? rectA.y : rectB.y;
+                int right = (rectA.x + rectA.width < rectB.x + rectB.width) ? rectA.x + rectA.width : rectB.x + rectB.width;
+                int bottom = (rectA.y + rectA.height < rectB.y + rectB.height) ? rectA.y + rectA.height : rectB.y + rectB.height;
+
+                if (left >= right || top >= bottom)
+                    continue;
+
+                // Colliders spanning several cells can share more than one.
+                // The pair is only reported from the cell holding the top
+                // left corner of the overlap, which both of them cover.
+                if ((left >> CELL_SHIFT) != own->cellX || (top >> CELL_SHIFT) != own->cellY)
+                    continue;
+
+                if (a->onContact != nullptr)
+                    a->onContact(a, b);
+                if (b->onContact != nullptr)
+                    b->onContact(b, a);
+            }
+        }
+    }
+}
@@ -0,0 +1,145 @@
+#include "dma.h"
+
+#include <ps1/registers.h>
+#include <ps1/system.h>
+#include <vendor/printf.h>
+
+#include "interrupts.h"
+
+#define DMA_TIMEOUT 0x100000
+
+typedef struct {
+    uint32_t address, bcr, chcr;
+} DMA_TRANSFER;
+
+typedef struct {
+    DMA_TRANSFER queue[DMA_QUEUE_LENGTH];
+    int head, count;
+    volatile bool running;
+    volatile uint32_t queued, done;
+} DMA_CHANNEL_STATE;
+
+static DMA_CHANNEL_STATE _channels[DMA_CHANNEL_COUNT];
+
+static void _start(DMAChannel channel, const DMA_TRANSFER *transfer) {
+    _channels[channel].running = true;
+
+    DMA_MADR(channel) = transfer->address;
+    DMA_BCR(channel) = transfer->bcr;
+    DMA_CHCR(channel) = transfer->chcr;
+}
+
+// Retires the running transfer if the hardware is done with it and starts the
+// next one. Called from the completion interrupt, and by anything waiting on
+// a channel in case interrupts are disabled, so it must run with them off and
+// do nothing if the transfer was already retired.
+static void _update(DMAChannel channel) {
+    DMA_CHANNEL_STATE *state = &_channels[channel];
+
+    if (!state->running || (DMA_CHCR(channel) & DMA_CHCR_ENABLE))
+        return;
+
+    state->running = false;
+    state->done++;
+
+    if (state->count) {
+        _start(channel, &state->queue[state->head]);
+        state->head = (state->head + 1) % DMA_QUEUE_LENGTH;
+        state->count--;
+    }
+}
+
+static void _update_polled(DMAChannel channel) {
+    bool enable = disableInterrupts();
+    _update(channel);
+    if (enable)
+        enableInterrupts();
+}
+
+static void _gpu_handler(void) {
+    _update(DMA_GPU);
+}
+
+static void _spu_handler(void) {
+    _update(DMA_SPU);
+}
+
+static void _mdec_in_handler(void) {
+    _update(DMA_MDEC_IN);
+}
+
+static void _mdec_out_handler(void) {
+    _update(DMA_MDEC_OUT);
+}
+
+void dma_init() {
+    interrupt_add_dma_handler(DMA_GPU, _gpu_handler);
+    interrupt_add_dma_handler(DMA_SPU, _spu_handler);
+    interrupt_add_dma_handler(DMA_MDEC_IN, _mdec_in_handler);
+    interrupt_add_dma_handler(DMA_MDEC_OUT, _mdec_out_handler);
+}
+
+DMA_FENCE dma_queue(DMAChannel channel, const void *address, uint32_t bcr, uint32_t chcr) {
+    DMA_CHANNEL_STATE *state = &_channels[channel];
+    DMA_TRANSFER transfer = { (uint32_t) address, bcr, chcr };
+
+    // Make room by waiting for the oldest queued transfer to start. The new
+    // transfer can't be dropped, as its fence would then be done before the
+    // ones queued ahead of it, so this waits for as long as it takes.
+    bool enable;
+    for (int i = DMA_TIMEOUT;; i--) {
+        enable = disableInterrupts();
+        _update(channel);
+
+        if (state->count < DMA_QUEUE_LENGTH)
+            break;
+
+        if (enable)
+            enableInterrupts();
+        if (!i)
+            printf("DMA queue %d stuck, CHCR=0x%08x\n", channel, DMA_CHCR(channel));
+    }
+
+    if (!state->running) {
+        _start(channel, &transfer);
+    }
+    else {
+        state->queue[(state->head + state->count) % DMA_QUEUE_LENGTH] = transfer;
+        state->count++;
+    }
+
+    DMA_FENCE fence = { channel, ++state->queued };
+
+    if (enable)
+        enableInterrupts();
+    return fence;
+}
+
+DMA_FENCE dma_get_fence(DMAChannel channel) {
+    DMA_FENCE fence = { channel, _channels[channel].queued };
+    return fence;
+}
+
+bool dma_is_done(DMA_FENCE fence) {
+    DMA_CHANNEL_STATE *state = &_channels[fence.channel];
+
+    if ((int32_t) (state->done - fence.sequence) >= 0)
+        return true;
+
+    _update_polled(fence.channel);
+    return (int32_t) (state->done - fence.sequence) >= 0;
+}
+
+bool dma_wait(DMA_FENCE fence) {
+    for (int i = DMA_TIMEOUT; i; i--) {
+        if (dma_is_done(fence))
+            return true;
+    }
+
+    printf("DMA %d timeout, CHCR=0x%08x\n", fence.channel, DMA_CHCR(fence.channel));
+    return false;
+}
+
+bool dma_wait_channel(DMAChannel channel) {
+    return dma_wait(dma_get_fence(channel));
+}
@@ -6,6 +6,7 @@
 #include <ps1/registers.h>
 #include <ps1/system.h>
 
+#include "dma.h"
 #include "vsync.h"
 #include "gte.h"
 
@@ -17,7 +18,6 @@
 
 // FIX: slower but fixes uploading textures whose size is not a multiple of 16 words
 #define DMA_MAX_CHUNK_SIZE 1
-#define CHAIN_BUFFER_SIZE 4096
 #define ORDERING_TABLE_SIZE 32
 
 typedef struct
@@ -30,8 +30,45 @@ typedef struct
 DMAChain *chain;
 uint8_t _graphicsMode;
 
+// Packets that don't fit in the chain are written here instead and dropped.
+// It's big enough for the longest packet a tag can describe.
+static uint32_t _discardedPacket[255];
+static bool _chainFull = false;
+
+// In high resolution mode the screen is 640x480 interlaced and there is only a
+// single framebuffer at the top left of VRAM. Drawing to the displayed area is
+// left prohibited, which makes the GPU skip the lines of the field currently
+// being scanned out, so each frame only ends up drawing the other field's
+// lines. This keeps the full frame rate without needing a second 640x480
+// buffer, as long as the scene is drawn within a single field.
+#define HIGH_RES_WIDTH 640
+#define HIGH_RES_HEIGHT 480
+
+bool _highResolution = false;
+int _screenWidth = SCREEN_WIDTH;
+int _screenHeight = SCREEN_HEIGHT;
+
+// Asynchronous VRAM fills and blits are appended to one of these small linked
+// lists and sent to the GPU by DMA once flushed, so the CPU doesn't have to
+// feed the GPU (or wait for it) while it's busy clearing or copying VRAM.
+#define VRAM_QUEUE_SIZE 256
+
+typedef struct
+{
+	uint32_t data[VRAM_QUEUE_SIZE];
+	uint32_t *nextPacket;
+	uint32_t *lastPacket;
+	DMA_FENCE sent;
+} VRAMQueue;
+
+VRAMQueue vramQueues[2];
+bool currentVramQueue = false;
+
 #define FONT_WIDTH 96
 #define FONT_HEIGHT 56
+// Right of both low resolution framebuffers, which also clears the high
+// resolution one
+#define FONT_X ((SCREEN_WIDTH * 2 > HIGH_RES_WIDTH) ? SCREEN_WIDTH * 2 : HIGH_RES_WIDTH)
 #define FONT_COLOR_DEPTH GP0_COLOR_4BPP
 extern const uint8_t debugFont[], debugFontPalette[];
 Texture *debugFontTexture;
@@ -63,9 +100,7 @@ void uploadIndexedTexture(
 	int widthDivider = (colorDepth == GP0_COLOR_8BPP) ? 2 : 4;
 
 	vram_send_data(image, x, y, width / widthDivider, height);
-	waitForDMATransfer(DMA_GPU, 100000);
 	vram_send_data(palette, paletteX, paletteY, numColors, 1);
-	waitForDMATransfer(DMA_GPU, 100000);
 
 	info->page = gp0_page(
 		x / 64, y / 256, GP0_BLEND_SEMITRANS, colorDepth);
@@ -82,7 +117,7 @@ void upload_debug_font() {
 		debugFontTexture = new Texture();
 	}
 	uploadIndexedTexture(
-		debugFontTexture, debugFont, debugFontPalette, SCREEN_WIDTH * 2, 0, SCREEN_WIDTH * 2,
+		debugFontTexture, debugFont, debugFontPalette, FONT_X, 0, FONT_X,
 		FONT_HEIGHT, FONT_WIDTH, FONT_HEIGHT, FONT_COLOR_DEPTH);
 	if(font == nullptr) {
 	font = new Font(debugFontTexture);
@@ -95,6 +130,9 @@ void upload_debug_font() {
 
 void load_scene(Scene *scene)
 {
+	if (scene->highResolution != _highResolution)
+		draw_set_high_resolution(scene->highResolution);
+
 	upload_debug_font();
 	draw_update(false);
 	draw_update(false);
@@ -104,7 +142,7 @@ void load_scene(Scene *scene)
 	}
 
 	if(scene->type == SCENE_3D) {
-		gte_setup_3d(SCREEN_WIDTH, SCREEN_HEIGHT, ORDERING_TABLE_SIZE);
+		gte_setup_3d(_screenWidth, _screenHeight, ORDERING_TABLE_SIZE);
 	}
 
 	scene->loadData();
@@ -124,22 +162,18 @@ static void gpu_gp0_wait_ready(void)
 		__asm__ volatile("");
 }
 
-static void dma_send_linked_list(const void *data)
+static DMA_FENCE dma_send_linked_list(const void *data)
 {
-
-	// Wait until the GPU's DMA unit has finished sending data and is ready.
-	while (DMA_CHCR(DMA_GPU) & DMA_CHCR_ENABLE)
-		__asm__ volatile("");
-
 	// Make sure the pointer is aligned to 32 bits (4 bytes). The DMA engine is
 	// not capable of reading unaligned data.
 
 	// Give DMA a pointer to the beginning of the data and tell it to send it in
 	// linked list mode. The DMA unit will start parsing a chain of "packets"
 	// from RAM, with each packet being made up of a 32-bit header followed by
-	// zero or more 32-bit commands to be sent to the GP0 register.
-	DMA_MADR(DMA_GPU) = (uint32_t)data;
-	DMA_CHCR(DMA_GPU) = DMA_CHCR_WRITE | DMA_CHCR_MODE_LIST | DMA_CHCR_ENABLE;
+	// zero or more 32-bit commands to be sent to the GP0 register. Lists need
+	// no other setup, so they're queued behind whatever the GPU channel is
+	// busy with rather than waiting for it.
+	return dma_queue(DMA_GPU, data, 0, DMA_CHCR_WRITE | DMA_CHCR_MODE_LIST | DMA_CHCR_ENABLE);
 }
 
 uint32_t *dma_allocate_packet(DMAChain *chain, int numCommands, int zIndex)
@@ -148,7 +182,14 @@ uint32_t *dma_allocate_packet(DMAChain *chain, int numCommands, int zIndex)
 	// a new packet. We have to allocate an extra word for the packet's header,
 	// which will contain the number of GP0 commands the packet is made up of as
 	// well as a pointer to the next packet (or a special "terminator" value to
-	// tell the DMA unit to stop).
+	// tell the DMA unit to stop). The last word of the buffer is kept for the
+	// end tag draw_update() writes.
+	if (chain->nextPacket + numCommands + 1 > &chain->data[CHAIN_BUFFER_SIZE - 1])
+	{
+		_chainFull = true;
+		return _discardedPacket;
+	}
+
 	uint32_t *ptr = chain->nextPacket;
 	chain->nextPacket += numCommands + 1;
 
@@ -163,9 +204,96 @@ uint32_t *dma_get_chain_pointer(int numCommands, int zIndex)
 	return dma_allocate_packet(chain, numCommands, zIndex);
 }
 
-void vram_send_data(const void *data, int x, int y, int width, int height)
+int dma_get_chain_space()
+{
+	return CHAIN_BUFFER_SIZE - 1 - (chain->nextPacket - chain->data);
+}
+
+static void vram_reset_queue(VRAMQueue *queue)
+{
+	queue->nextPacket = queue->data;
+	queue->lastPacket = nullptr;
+}
+
+static uint32_t *vram_allocate_packet(int numCommands)
+{
+	VRAMQueue *queue = &vramQueues[currentVramQueue];
+
+	// If the queue is full, send it off and start filling the other one.
+	if ((queue->nextPacket + numCommands + 1) > &queue->data[VRAM_QUEUE_SIZE])
+	{
+		vram_flush();
+		queue = &vramQueues[currentVramQueue];
+	}
+
+	// Each new packet is terminated and the previous one is patched to point
+	// to it, so the list is always valid in case it gets flushed now.
+	uint32_t *ptr = queue->nextPacket;
+	queue->nextPacket += numCommands + 1;
+
+	*ptr = gp0_endTag(numCommands);
+	if (queue->lastPacket)
+		*(queue->lastPacket) = (*(queue->lastPacket) & 0xff000000) | ((uint32_t) ptr & 0xffffff);
+
+	queue->lastPacket = ptr;
+	return &ptr[1];
+}
+
+void vram_fill(int x, int y, int width, int height, uint8_t r, uint8_t g, uint8_t b)
+{
+	uint32_t *ptr = vram_allocate_packet(3);
+	ptr[0] = gp0_rgb(r, g, b) | gp0_vramFill();
+	ptr[1] = gp0_xy(x, y);
+	ptr[2] = gp0_xy(width, height);
+}
+
+void vram_blit(int srcX, int srcY, int x, int y, int width, int height)
+{
+	uint32_t *ptr = vram_allocate_packet(4);
+	ptr[0] = gp0_vramBlit();
+	ptr[1] = gp0_xy(srcX, srcY);
+	ptr[2] = gp0_xy(x, y);
+	ptr[3] = gp0_xy(width, height);
+}
+
+void vram_flush()
+{
+	VRAMQueue *queue = &vramQueues[currentVramQueue];
+	if (queue->lastPacket == nullptr)
+		return;
+
+	queue->sent = dma_send_linked_list(queue->data);
+
+	// The other queue can only be reused once its list has been sent, which
+	// it usually has by the time this one fills up.
+	currentVramQueue = !currentVramQueue;
+	dma_wait(vramQueues[currentVramQueue].sent);
+	vram_reset_queue(&vramQueues[currentVramQueue]);
+}
+
+bool vram_is_busy()
+{
+	if (vramQueues[currentVramQueue].lastPacket != nullptr)
+		return true;
+	if (!dma_is_done(dma_get_fence(DMA_GPU)))
+		return true;
+
+	return !(GPU_GP1 & GP1_STAT_CMD_READY);
+}
+
+void vram_sync()
 {
-	waitForDMATransfer(DMA_GPU, 100000);
+	vram_flush();
+	dma_wait_channel(DMA_GPU);
+	gpu_gp0_wait_ready();
+}
+
+DMA_FENCE vram_send_data(const void *data, int x, int y, int width, int height)
+{
+	// Make sure any queued fills or blits land before this upload. The GP0
+	// header below can't be written while anything else is being sent.
+	vram_flush();
+	dma_wait_channel(DMA_GPU);
 
 	// Calculate how many 32-bit words will be sent from the width and height of
 	// the texture. If more than 16 words have to be sent, configure DMA to
@@ -199,24 +327,41 @@ void vram_send_data(const void *data, int x, int y, int width, int height)
 
 	// Give DMA a pointer to the beginning of the data and tell it to send it in
 	// slice (chunked) mode.
-	DMA_MADR(DMA_GPU) = (uint32_t)data;
-	DMA_BCR(DMA_GPU) = chunkSize | (numChunks << 16);
-	DMA_CHCR(DMA_GPU) = DMA_CHCR_WRITE | DMA_CHCR_MODE_SLICE | DMA_CHCR_ENABLE;
+	return dma_queue(DMA_GPU, data, chunkSize | (numChunks << 16), DMA_CHCR_WRITE | DMA_CHCR_MODE_SLICE | DMA_CHCR_ENABLE);
 }
 
-void gpu_setup(GP1VideoMode mode, int width, int height)
+// Center of the visible area (in GPU clock cycles horizontally and scanlines
+// vertically) and exact refresh rates in millihertz for each region, indexed
+// by GRAPHICS_MODE_*. The non-interlaced rates are below 50 and 60 Hz as
+// each frame is longer than an interlaced field (314 and 263 lines instead of
+// 312.5 and 262.5).
+typedef struct
+{
+	GP1VideoMode mode;
+	int centerX, centerY;
+	int refreshRate, interlacedRefreshRate;
+} VideoTiming;
+
+static uint8_t _consoleMode = GRAPHICS_MODE_NTSC;
+
+static const VideoTiming _videoTimings[2] = {
+	{ GP1_MODE_PAL,  0x760, 0xa3, 49761, 50000 },
+	{ GP1_MODE_NTSC, 0x760, 0x88, 59826, 59940 }
+};
+
+void gpu_setup(const VideoTiming *timing, int width, int height, bool highResolution)
 {
 
 	DMA_DPCR |= DMA_DPCR_ENABLE << (DMA_GPU * 4);
 	DMA_DPCR |= DMA_DPCR_ENABLE << (DMA_OTC * 4);
 
 	// Origin of framebuffer based on if PAL or NTSC
-	int x = 0x760;
-	int y = (mode = GP1_MODE_PAL) ? 0xa3 : 0x88;
+	int x = timing->centerX;
+	int y = timing->centerY;
 
 	// We need to do some timing magic to actually achieve our desired resolution
-	GP1HorizontalRes horizontalRes = GP1_HRES_320;
-	GP1VerticalRes verticalRes = GP1_VRES_256;
+	GP1HorizontalRes horizontalRes = highResolution ? GP1_HRES_640 : GP1_HRES_320;
+	GP1VerticalRes verticalRes = highResolution ? GP1_VRES_512 : GP1_VRES_256;
 
 	int offsetX = (width * gp1_clockMultiplierH(horizontalRes)) / 2;
 	int offsetY = (height / gp1_clockDividerV(verticalRes)) / 2;
@@ -225,7 +370,7 @@ void gpu_setup(GP1VideoMode mode, int width, int height)
 	GPU_GP1 = gp1_fbRangeH(x - offsetX, x + offsetX);
 	GPU_GP1 = gp1_fbRangeV(y - offsetY, y + offsetY);
 	GPU_GP1 = gp1_fbMode(
-		horizontalRes, verticalRes, mode, false, GP1_COLOR_16BPP);
+		horizontalRes, verticalRes, timing->mode, highResolution, GP1_COLOR_16BPP);
 
 	GPU_GP1 = gp1_dmaRequestMode(GP1_DREQ_GP0_WRITE);
 	GPU_GP1 = gp1_dispBlank(false);
@@ -243,87 +388,259 @@ static void gpu_wait_vsync(void)
 
 void draw_init()
 {
+	// Remember the mode the BIOS set up, which matches the console's region,
+	// before anything else changes it.
 	if ((GPU_GP1 & GP1_STAT_MODE_BITMASK) == GP1_STAT_MODE_PAL)
+		_consoleMode = GRAPHICS_MODE_PAL;
+	else
+		_consoleMode = GRAPHICS_MODE_NTSC;
+
+	draw_set_graphics_mode(VIDEO_MODE);
+
+	vram_reset_queue(&vramQueues[0]);
+	vram_reset_queue(&vramQueues[1]);
+}
+
+bool currentBuffer = false;
+DMAChain dmaChains[2];
+void tick_scene()
+{
+	activeScene->sceneLoop();
+}
+
+// Clears part of the frame. This uses a rectangle rather than a VRAM fill in
+// high resolution mode, as fills ignore the display area lock and would also
+// erase the field being displayed.
+static void draw_clear(int frameX, int frameY, const Rect *area, uint8_t r, uint8_t g, uint8_t b)
+{
+	uint32_t *ptr = dma_allocate_packet(chain, 3, ORDERING_TABLE_SIZE-1);
+
+	if (_highResolution)
 	{
-		gpu_setup(GP1_MODE_PAL, SCREEN_WIDTH, SCREEN_HEIGHT);
-		_graphicsMode = GRAPHICS_MODE_PAL;
+		ptr[0] = gp0_rgb(r, g, b) | gp0_rectangle(false, false, false);
+		ptr[1] = gp0_xy(area->x, area->y);
 	}
 	else
 	{
-		gpu_setup(GP1_MODE_NTSC, SCREEN_WIDTH, SCREEN_HEIGHT);
-		_graphicsMode = GRAPHICS_MODE_NTSC;
+		ptr[0] = gp0_rgb(r, g, b) | gp0_vramFill();
+		ptr[1] = gp0_xy(frameX + area->x, frameY + area->y);
 	}
-	GPU_GP1 = gp1_dispBlank(false);
+	ptr[2] = gp0_xy(area->width, area->height);
 }
 
-bool currentBuffer = false;
-DMAChain dmaChains[2];
-void draw_update(bool doGameTick)
+void rect_add(Rect *rect, const Rect *other)
 {
-	if (doGameTick)
-		activeScene->sceneLoop();
+	if (other->width <= 0 || other->height <= 0)
+		return;
 
-	int frameX = currentBuffer ? SCREEN_WIDTH : 0;
-	int frameY = 0;
+	if (rect->width <= 0 || rect->height <= 0)
+	{
+		*rect = *other;
+		return;
+	}
 
-	chain = &dmaChains[currentBuffer];
-	currentBuffer = !currentBuffer;
+	int right = rect->x + rect->width;
+	int bottom = rect->y + rect->height;
 
-	uint32_t *ptr;
-	GPU_GP1 = gp1_fbOffset(frameX, frameY);
+	if (other->x < rect->x)
+		rect->x = other->x;
+	if (other->y < rect->y)
+		rect->y = other->y;
+	if (other->x + other->width > right)
+		right = other->x + other->width;
+	if (other->y + other->height > bottom)
+		bottom = other->y + other->height;
 
-	clearOrderingTable(chain->orderingTable, ORDERING_TABLE_SIZE);
-	chain->nextPacket = chain->data;
+	rect->width = right - rect->x;
+	rect->height = bottom - rect->y;
+}
 
-	if (!doGameTick)
+bool rect_overlaps(const Rect *a, const Rect *b)
+{
+	return (a->x < b->x + b->width) && (b->x < a->x + a->width) &&
+		(a->y < b->y + b->height) && (b->y < a->y + a->height);
+}
+
+bool rect_to_screen(Rect *rect, bool screenSpace)
+{
+	if (!screenSpace && activeScene != nullptr)
+	{
+		rect->x -= activeScene->camera2D.x;
+		rect->y -= activeScene->camera2D.y;
+	}
+
+	return (rect->x < _screenWidth) && (rect->x + rect->width > 0) &&
+		(rect->y < _screenHeight) && (rect->y + rect->height > 0);
+}
+
+// Area that changed in the previous frame. Each buffer was last drawn two
+// frames ago, so it's missing both the previous and the current frame's
+// changes.
+static Rect _lastDirtyRect;
+static bool _forceRedraw = true;
+
+// Returns the part of the frame that has to be redrawn for scenes using
+// partial redraws.
+static Rect draw_get_redraw_area()
+{
+	Rect screen = {0, 0, _screenWidth, _screenHeight};
+	Rect dirty = {0, 0, 0, 0};
+	bool tracked = true;
+
+	GAMEOBJECT_ENTRY *entry = &activeScene->_linked_list;
+	while (entry != nullptr && entry->object != nullptr)
+	{
+		// Every object has to be checked even if we already know the whole
+		// screen is going to be redrawn, so they all remember their state
+		if (!entry->object->trackChanges(&dirty))
+			tracked = false;
+		entry = entry->next;
+	}
+
+	if (!tracked || _forceRedraw)
+		dirty = screen;
+	_forceRedraw = false;
+
+	Rect redraw = dirty;
+	rect_add(&redraw, &_lastDirtyRect);
+	_lastDirtyRect = dirty;
+
+	if (redraw.width <= 0 || redraw.height <= 0)
+		return redraw;
+
+	// VRAM fills work in 16 pixel wide columns, so the area is widened to
+	// match them to avoid clearing pixels that won't be drawn over.
+	int right = (redraw.x + redraw.width + 15) & ~15;
+	int bottom = redraw.y + redraw.height;
+	redraw.x &= ~15;
+
+	if (redraw.x < 0)
+		redraw.x = 0;
+	if (redraw.y < 0)
+		redraw.y = 0;
+	if (right > screen.width)
+		right = screen.width;
+	if (bottom > screen.height)
+		bottom = screen.height;
+
+	redraw.width = right - redraw.x;
+	redraw.height = bottom - redraw.y;
+	return redraw;
+}
+
+// Draws the background and scene (or the loading screen) into the given part
+// of the frame.
+static void draw_frame(int frameX, int frameY, const Rect *area, bool drawScene, bool partial)
+{
+	uint32_t *ptr;
+
+	// Backgrounds are blitted, which can't be done without tearing when
+	// there's a single framebuffer, so high resolution scenes only get a
+	// solid color.
+	if (!drawScene)
 	{
-		ptr = dma_allocate_packet(chain, 3, ORDERING_TABLE_SIZE-1);
-		ptr[0] = gp0_rgb(0, 0, 0) | gp0_vramFill();
-		ptr[1] = gp0_xy(frameX, frameY);
-		ptr[2] = gp0_xy(SCREEN_WIDTH, SCREEN_HEIGHT);
+		draw_clear(frameX, frameY, area, 0, 0, 0);
 	}
-	else if (activeScene->backgroundImage == nullptr)
+	else if (activeScene->backgroundImage == nullptr || _highResolution)
 	{
-		ptr = dma_allocate_packet(chain, 3, ORDERING_TABLE_SIZE-1);
-		ptr[0] = gp0_rgb(64, 64, 64) | gp0_vramFill();
-		ptr[1] = gp0_xy(frameX, frameY);
-		ptr[2] = gp0_xy(SCREEN_WIDTH, SCREEN_HEIGHT);
+		draw_clear(frameX, frameY, area, 64, 64, 64);
 	}
 	else
 	{
 		ptr = dma_allocate_packet(chain, 4, ORDERING_TABLE_SIZE-1);
 		ptr[0] = gp0_vramBlit();
-		ptr[1] = gp0_xy(activeScene->backgroundImage->x, activeScene->backgroundImage->y);
-		ptr[2] = gp0_xy(frameX, frameY);
-		ptr[3] = gp0_xy(SCREEN_WIDTH, SCREEN_HEIGHT);
+		ptr[1] = gp0_xy(activeScene->backgroundImage->x + area->x, activeScene->backgroundImage->y + area->y);
+		ptr[2] = gp0_xy(frameX + area->x, frameY + area->y);
+		ptr[3] = gp0_xy(area->width, area->height);
 	}
 
+	// Limiting the drawing area to the redrawn part makes the GPU clip
+	// anything that only partially overlaps it.
 	ptr = dma_allocate_packet(chain, 4, ORDERING_TABLE_SIZE-1);
 	ptr[0] = gp0_texpage(0, true, false);
-	ptr[1] = GPU_GP0 = gp0_fbOffset1(frameX, frameY);
+	ptr[1] = GPU_GP0 = gp0_fbOffset1(frameX + area->x, frameY + area->y);
 	ptr[2] = GPU_GP0 = gp0_fbOffset2(
-		frameX + SCREEN_WIDTH - 1, frameY + SCREEN_HEIGHT - 1);
+		frameX + area->x + area->width - 1, frameY + area->y + area->height - 1);
 
 	ptr[3] = gp0_fbOrigin(frameX, frameY);
 
-	if (doGameTick)
+	if (drawScene)
 	{
 		GAMEOBJECT_ENTRY *entry = &activeScene->_linked_list;
 		while (entry != nullptr && entry->object != nullptr)
 		{
-			entry->object->execute();
+			entry->object->execute(partial ? area : nullptr);
 			entry = entry->next;
 		}
 	}
 	else {
-		font->printString(135,110, "LOADING...", 0);
+		font->printString(_screenWidth / 2 - 25, _screenHeight / 2 - 10, "LOADING...", 0);
+	}
+}
+
+void draw_update(bool drawScene)
+{
+	int frameX = (currentBuffer && !_highResolution) ? _screenWidth : 0;
+	int frameY = 0;
+
+	chain = &dmaChains[currentBuffer];
+	currentBuffer = !currentBuffer;
+
+	// The previous frame is drawn while the next one's ticks run, so it has to
+	// be finished before it's shown. Waiting for the whole channel also makes
+	// it safe to write to GP0 directly below.
+	dma_wait_channel(DMA_GPU);
+	gpu_gp0_wait_ready();
+
+	GPU_GP1 = gp1_fbOffset(frameX, frameY);
+
+	clearOrderingTable(chain->orderingTable, ORDERING_TABLE_SIZE);
+	chain->nextPacket = chain->data;
+
+	// The single buffer in high resolution mode only gets half of its lines
+	// drawn each frame, so it always has to be redrawn completely.
+	bool partial = drawScene && activeScene->partialRedraw && !_highResolution;
+	Rect area = {0, 0, _screenWidth, _screenHeight};
+
+	if (partial)
+		area = draw_get_redraw_area();
+	else
+		_forceRedraw = true;
+
+	// If nothing changed in either buffer there's nothing to draw at all.
+	if (area.width > 0 && area.height > 0)
+		draw_frame(frameX, frameY, &area, drawScene, partial);
+
+	if (_chainFull)
+	{
+		printf("Chain full, some primitives weren't drawn. Raise CHAIN_BUFFER_SIZE\n");
+		_chainFull = false;
 	}
 
 	*(chain->nextPacket) = gp0_endTag(0);
+	vram_flush();
 	gpu_gp0_wait_ready();
 	VSync(0);
 	dma_send_linked_list(&(chain->orderingTable)[ORDERING_TABLE_SIZE - 1]);
-	waitForDMATransfer(DMA_GPU, 100000);
+}
+
+void draw_set_graphics_mode(uint8_t mode)
+{
+	if (mode > GRAPHICS_MODE_AUTO)
+	{
+		printf("Invalid video mode %d, using GRAPHICS_MODE_AUTO\n", mode);
+		mode = GRAPHICS_MODE_AUTO;
+	}
+
+	if (mode == GRAPHICS_MODE_AUTO)
+		mode = _consoleMode;
+
+	// Resetting the GPU would abort any transfer still in progress.
+	vram_sync();
+
+	_graphicsMode = mode;
+	gpu_setup(&_videoTimings[mode], _screenWidth, _screenHeight, _highResolution);
+	GPU_GP1 = gp1_dispBlank(false);
 }
 
 uint8_t draw_get_graphics_mode()
@@ -331,6 +648,61 @@ uint8_t draw_get_graphics_mode()
 	return _graphicsMode;
 }
 
+int draw_get_refresh_rate()
+{
+	const VideoTiming *timing = &_videoTimings[_graphicsMode];
+	return _highResolution ? timing->interlacedRefreshRate : timing->refreshRate;
+}
+
+void draw_set_high_resolution(bool enable)
+{
+	vram_sync();
+
+	_highResolution = enable;
+	_screenWidth = enable ? HIGH_RES_WIDTH : SCREEN_WIDTH;
+	_screenHeight = enable ? HIGH_RES_HEIGHT : SCREEN_HEIGHT;
+	currentBuffer = false;
+
+	gpu_setup(&_videoTimings[_graphicsMode], _screenWidth, _screenHeight, _highResolution);
+
+	// Get rid of whatever was left in VRAM by the previous mode.
+	vram_fill(0, 0, _screenWidth * (enable ? 1 : 2), _screenHeight, 0, 0, 0);
+	vram_sync();
+	GPU_GP1 = gp1_dispBlank(false);
+}
+
+bool draw_is_high_resolution()
+{
+	return _highResolution;
+}
+
+int draw_get_screen_width()
+{
+	return _screenWidth;
+}
+
+int draw_get_screen_height()
+{
+	return _screenHeight;
+}
+
+bool vram_page_is_reserved(int page)
+{
+	// Framebuffers always start at the top left corner of VRAM.
+	int width = _highResolution ? HIGH_RES_WIDTH : (SCREEN_WIDTH * 2);
+	int height = _highResolution ? HIGH_RES_HEIGHT : SCREEN_HEIGHT;
+
+	return ((page % 16) * 64 < width) && ((page / 16) * 256 < height);
+}
+
+bool vram_page_is_reserved_in_any_mode(int page)
+{
+	int width = (SCREEN_WIDTH * 2 > HIGH_RES_WIDTH) ? SCREEN_WIDTH * 2 : HIGH_RES_WIDTH;
+	int height = (SCREEN_HEIGHT > HIGH_RES_HEIGHT) ? SCREEN_HEIGHT : HIGH_RES_HEIGHT;
+
+	return ((page % 16) * 64 < width) && ((page / 16) * 256 < height);
+}
+
 int getOtSize() {
 	return ORDERING_TABLE_SIZE;
 }
@@ -0,0 +1,74 @@
+#include "gameloop.h"
+
+#include <stdint.h>
+
+#include "collision.h"
+#include "draw.h"
+#include "vsync.h"
+
+#include "psbw/Controller.h"
+#include "psbw/Scene.h"
+
+// Game logic always runs at TICK_RATE ticks per second regardless of the video
+// mode or of how long rendering takes. The vblank counter is used as the time
+// base: every vblank adds TICK_RATE to the accumulator and every tick removes
+// the refresh rate from it, so e.g. on PAL (50 Hz) a 60 Hz game runs an extra
+// tick every fifth frame. Refresh rates are in millihertz since neither region
+// actually runs at exactly 50 or 60 Hz.
+static uint32_t _last_vblank;
+static int _tick_accumulator;
+static uint32_t _tick_count;
+
+void gameloop_init() {
+    _last_vblank = VSync(-1);
+    _tick_accumulator = 0;
+    _tick_count = 0;
+}
+
+void gameloop_update() {
+    uint32_t vblank = VSync(-1);
+    int refreshRate = draw_get_refresh_rate();
+
+    _tick_accumulator += (vblank - _last_vblank) * TICK_RATE * 1000;
+    _last_vblank = vblank;
+
+    int ticks = _tick_accumulator / refreshRate;
+    _tick_accumulator -= ticks * refreshRate;
+
+    // If we fell too far behind (e.g. after a long stall) drop the backlog
+    // rather than trying to catch up, which would only make things worse.
+    if (ticks > MAX_TICKS_PER_FRAME) {
+        ticks = MAX_TICKS_PER_FRAME;
+        _tick_accumulator = 0;
+    }
+
+    Scene *scene = get_active_scene();
+
+    for (; ticks; ticks--) {
+        ctrl_update();
+        tick_scene();
+        _tick_count++;
+
+        // Loading a scene takes a long time and the old one no longer exists,
+        // so don't count the loading time as ticks to be caught up on.
+        if (get_active_scene() != scene) {
+            _last_vblank = VSync(-1);
+            _tick_accumulator = 0;
+            break;
+        }
+
+        // Contacts are reported once objects have moved for this tick, so
+        // the scene can react to them in its next sceneLoop()
+        collision_update(scene->_collisions);
+    }
+
+    draw_update(true);
+}
+
+uint32_t gameloop_get_tick_count() {
+    return _tick_count;
+}
+
+int gameloop_get_tick_rate() {
+    return TICK_RATE;
+}
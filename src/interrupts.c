@@ -2,37 +2,232 @@
 
 #include <ps1/registers.h>
 
-void (*cdCallback)(void);
-void (*vsyncCallback)(void);
+#include "vsync.h"
 
-static void _interruptHandler() {
-    if (acknowledgeInterrupt(IRQ_CDROM)) {
-        cdCallback();
+// Handlers are kept in fixed size lists so nothing has to be allocated and
+// the dispatcher never has to follow pointers into the heap.
+typedef struct {
+    IRQ_HANDLER_STATS handlers[IRQ_MAX_HANDLERS];
+    int count;
+} HANDLER_LIST;
+
+static HANDLER_LIST _irq_handlers[IRQ_CHANNEL_COUNT];
+static HANDLER_LIST _dma_handlers[DMA_CHANNEL_COUNT];
+static bool _dma_installed = false;
+
+static uint32_t _load_frame, _load_cycles, _load;
+
+static void _run_handlers(HANDLER_LIST *list) {
+    for (int i = 0; i < list->count; i++) {
+        IRQ_HANDLER_STATS *stats = &list->handlers[i];
+
+        uint16_t start = TIMER_VALUE(0);
+        stats->handler();
+        uint16_t cycles = TIMER_VALUE(0) - start;
+
+        stats->calls++;
+        stats->totalCycles += cycles;
+        if (cycles > stats->maxCycles)
+            stats->maxCycles = cycles;
+    }
+}
+
+static bool _add_handler(HANDLER_LIST *list, IRQHandler handler) {
+    bool enable = disableInterrupts();
+    bool added = false;
+
+    if (list->count < IRQ_MAX_HANDLERS) {
+        IRQ_HANDLER_STATS *stats = &list->handlers[list->count];
+        stats->handler = handler;
+        stats->calls = 0;
+        stats->totalCycles = 0;
+        stats->maxCycles = 0;
+
+        list->count++;
+        added = true;
+    }
+
+    if (enable)
+        enableInterrupts();
+    return added;
+}
+
+static void _remove_handler(HANDLER_LIST *list, IRQHandler handler) {
+    bool enable = disableInterrupts();
+
+    for (int i = 0; i < list->count; i++) {
+        if (list->handlers[i].handler != handler)
+            continue;
+
+        // Keep the order handlers were added in
+        for (int j = i + 1; j < list->count; j++)
+            list->handlers[j - 1] = list->handlers[j];
+
+        list->count--;
+        break;
     }
-    if(acknowledgeInterrupt(IRQ_VSYNC)) {
-        vsyncCallback();
+
+    if (enable)
+        enableInterrupts();
+}
+
+// DMA interrupts are shared by all channels, DICR says which ones are done.
+// Writing its flags back clears them. The IRQ only fires again once none of
+// the enabled channels' flags are left, so channels finishing while the
+// handlers run are picked up before returning.
+static void _dma_handler(void) {
+    for (;;) {
+        uint32_t dicr = DMA_DICR;
+        uint32_t done = (dicr & DMA_DICR_CH_STAT_BITMASK) >> 24;
+        done &= (dicr & DMA_DICR_CH_ENABLE_BITMASK) >> 16;
+
+        if (!done)
+            break;
+
+        DMA_DICR = (dicr & ~(DMA_DICR_CH_STAT_BITMASK | DMA_DICR_IRQ)) | (done << 24);
+
+        for (int channel = 0; done; channel++, done >>= 1) {
+            if (done & 1)
+                _run_handlers(&_dma_handlers[channel]);
+        }
+    }
+}
+
+static uint32_t _total_cycles(void) {
+    uint32_t total = 0;
+    bool enable = disableInterrupts();
+
+    for (int i = 0; i < IRQ_CHANNEL_COUNT + DMA_CHANNEL_COUNT; i++) {
+        HANDLER_LIST *list = (i < IRQ_CHANNEL_COUNT) ? &_irq_handlers[i] : &_dma_handlers[i - IRQ_CHANNEL_COUNT];
+
+        for (int j = 0; j < list->count; j++)
+            total += list->handlers[j].totalCycles;
+    }
+
+    if (enable)
+        enableInterrupts();
+    return total;
+}
+
+// Idle task adding up the handler timings every IRQ_LOAD_FRAMES frames. It
+// never finishes.
+static bool _update_load(void *arg) {
+    uint32_t frame = VSync(-1);
+    if (frame - _load_frame < IRQ_LOAD_FRAMES)
+        return false;
+
+    // Removing handlers or resetting the stats makes the total go down, in
+    // which case there's nothing to compare against
+    uint32_t cycles = _total_cycles();
+    if (cycles >= _load_cycles)
+        _load = (cycles - _load_cycles) / (frame - _load_frame);
+
+    _load_frame = frame;
+    _load_cycles = cycles;
+    return false;
+}
+
+static void _interruptHandler(void *arg) {
+    uint32_t pending = IRQ_STAT & IRQ_MASK;
+    IRQ_STAT = ~pending;
+
+    while (pending) {
+        int channel = __builtin_ctz(pending);
+        pending &= pending - 1;
+
+        _run_handlers(&_irq_handlers[channel]);
     }
 }
 
 void interrupt_init() {
+    // Timer 0 counts CPU cycles for handler timings. Timer 1 is used by
+    // VSync() and timer 2 by the scheduler.
+    TIMER_CTRL(0) = 0;
+
     installExceptionHandler();
     setInterruptHandler(_interruptHandler, ((void *)0));
 	enableInterrupts();
+
+    vsync_add_idle_task(_update_load, (void *) 0);
+}
+
+bool interrupt_add_handler(IRQChannel channel, IRQHandler handler) {
+    if (!_add_handler(&_irq_handlers[channel], handler))
+        return false;
+
+    IRQ_MASK |= 1 << channel;
+    return true;
+}
+
+void interrupt_remove_handler(IRQChannel channel, IRQHandler handler) {
+    _remove_handler(&_irq_handlers[channel], handler);
+
+    if (!_irq_handlers[channel].count)
+        IRQ_MASK &= ~(1 << channel);
 }
 
 void interrupt_install_callback(IRQChannel channel, void (*cb)(void)) {
-    switch (channel)
-    {
-    case IRQ_CDROM:
-        cdCallback = cb;
-        IRQ_MASK |= 1 << IRQ_CDROM;
-        break;
-    
-    case IRQ_VSYNC:
-        vsyncCallback = cb;
-        IRQ_MASK |= 1 << IRQ_VSYNC;
-        break;
-    default:
-        break;
+    interrupt_add_handler(channel, cb);
+}
+
+bool interrupt_add_dma_handler(DMAChannel channel, IRQHandler handler) {
+    if (!_dma_installed) {
+        if (!interrupt_add_handler(IRQ_DMA, _dma_handler))
+            return false;
+        _dma_installed = true;
+    }
+
+    if (!_add_handler(&_dma_handlers[channel], handler))
+        return false;
+
+    // Flags are cleared by writing them, so none are written here
+    bool enable = disableInterrupts();
+    DMA_DICR = (DMA_DICR & ~(DMA_DICR_CH_STAT_BITMASK | DMA_DICR_IRQ)) | DMA_DICR_CH_ENABLE(channel) | DMA_DICR_IRQ_ENABLE;
+    if (enable)
+        enableInterrupts();
+
+    return true;
+}
+
+void interrupt_remove_dma_handler(DMAChannel channel, IRQHandler handler) {
+    _remove_handler(&_dma_handlers[channel], handler);
+
+    if (_dma_handlers[channel].count)
+        return;
+
+    bool enable = disableInterrupts();
+    DMA_DICR &= ~(DMA_DICR_CH_STAT_BITMASK | DMA_DICR_IRQ | DMA_DICR_CH_ENABLE(channel));
+    if (enable)
+        enableInterrupts();
+}
+
+const IRQ_HANDLER_STATS *interrupt_get_stats(IRQChannel channel, int *count) {
+    *count = _irq_handlers[channel].count;
+    return _irq_handlers[channel].handlers;
+}
+
+const IRQ_HANDLER_STATS *interrupt_get_dma_stats(DMAChannel channel, int *count) {
+    *count = _dma_handlers[channel].count;
+    return _dma_handlers[channel].handlers;
+}
+
+void interrupt_reset_stats() {
+    bool enable = disableInterrupts();
+
+    for (int i = 0; i < IRQ_CHANNEL_COUNT + DMA_CHANNEL_COUNT; i++) {
+        HANDLER_LIST *list = (i < IRQ_CHANNEL_COUNT) ? &_irq_handlers[i] : &_dma_handlers[i - IRQ_CHANNEL_COUNT];
+
+        for (int j = 0; j < list->count; j++) {
+            list->handlers[j].calls = 0;
+            list->handlers[j].totalCycles = 0;
+            list->handlers[j].maxCycles = 0;
+        }
     }
-}
\ No newline at end of file
+
+    if (enable)
+        enableInterrupts();
+}
+
+uint32_t interrupt_get_load() {
+    return _load;
+}
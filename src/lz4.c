@@ -0,0 +1,90 @@
+#include "lz4.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MIN_MATCH_LENGTH 4
+
+// Reads the extra bytes of a length field whose 4-bit part was 15.
+static const uint8_t *_read_length(
+	const uint8_t *ptr, const uint8_t *end, size_t *length
+) {
+	uint8_t value;
+
+	do {
+		if (ptr >= end)
+			return 0;
+
+		value    = *(ptr++);
+		*length += value;
+	} while (value == 255);
+
+	return ptr;
+}
+
+int lz4_decompress(
+	const uint8_t *input, size_t inputLength, uint8_t *output,
+	size_t outputLength
+) {
+	const uint8_t *ip    = input;
+	const uint8_t *ipEnd = input + inputLength;
+	uint8_t       *op    = output;
+	uint8_t       *opEnd = output + outputLength;
+
+	while (ip < ipEnd) {
+		uint8_t token  = *(ip++);
+		size_t  length = token >> 4;
+
+		// Copy the literals that precede the match.
+		if (length == 15) {
+			ip = _read_length(ip, ipEnd, &length);
+			if (!ip)
+				return -1;
+		}
+		if ((length > (size_t) (ipEnd - ip)) || (length > (size_t) (opEnd - op)))
+			return -1;
+
+		memcpy(op, ip, length);
+		ip += length;
+		op += length;
+
+		// The last sequence of a block only contains literals.
+		if (ip >= ipEnd)
+			break;
+		if ((ipEnd - ip) < 2)
+			return -1;
+
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+
+		if (!offset || (offset > (size_t) (op - output)))
+			return -1;
+
+		length = token & 15;
+		if (length == 15) {
+			ip = _read_length(ip, ipEnd, &length);
+			if (!ip)
+				return -1;
+		}
+		length += MIN_MATCH_LENGTH;
+
+		if (length > (size_t) (opEnd - op))
+			return -1;
+
+		// Matches can overlap the data they produce (e.g. an offset of 1
+		// repeats the last byte), so they are copied one byte at a time
+		// unless the source is far enough behind to use memcpy().
+		const uint8_t *match = op - offset;
+
+		if (offset >= length) {
+			memcpy(op, match, length);
+			op += length;
+		} else {
+			for (; length; length--)
+				*(op++) = *(match++);
+		}
+	}
+
+	return op - output;
+}
@@ -9,6 +9,10 @@
 #include "cdrom.h"
 #include "vsync.h"
 #include "interrupts.h"
+#include "dma.h"
+#include "scheduler.h"
+#include "gameloop.h"
+#include "benchmark.h"
 
 #include "psbw/Sio.h"
 #include "sio0.h"
@@ -17,16 +21,22 @@
 
 void main() {
 	interrupt_init();
+	dma_init();
+	scheduler_init();
 	sio_init(SIO_BAUD_115200);
 	vsync_init();
+#if MEMORY_BENCHMARK
+	// Needs the serial port for its output and timer 1 counting hblanks
+	benchmark_memory();
+#endif
 	draw_init();
 	sio0_init();
 	spu_init();
 	CdInit();
 	game_setup();
+	gameloop_init();
 
 	for(;;) {
-		ctrl_update();
-		draw_update(true);
+		gameloop_update();
 	}
 }
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "mdec.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <ps1/registers.h>
+#include <ps1/system.h>
+
+#include "draw.h"
+
+#define DMA_BLOCK_SIZE 32 // Words transferred per DMA request
+
+#define MDEC_CMD_DECODE 0x38000000 // Decode to 15bpp pixels, unsigned
+#define MDEC_CMD_SET_QUANT 0x40000001 // Luma and chroma tables follow
+#define MDEC_CMD_SET_SCALE 0x60000000
+
+// MPEG-1's default intra quantization table (with 2 instead of 8 for the DC
+// coefficient) in zigzag order, used for both luma and chroma. It must match
+// the one in tools/convertMdec.py.
+alignas(4) static const uint8_t _quant_table[64] = {
+     2, 16, 16, 19, 16, 19, 22, 22,
+    22, 22, 22, 22, 26, 24, 26, 27,
+    27, 27, 26, 26, 26, 26, 27, 27,
+    27, 29, 29, 29, 34, 34, 34, 29,
+    29, 29, 27, 27, 29, 29, 32, 32,
+    34, 34, 37, 38, 37, 35, 35, 34,
+    35, 38, 38, 40, 40, 40, 48, 48,
+    46, 46, 56, 56, 58, 69, 69, 83
+};
+
+// Standard IDCT basis matrix as used by the BIOS
+static const int16_t _scale_table[64] = {
+    0x5a82,  0x5a82,  0x5a82,  0x5a82,  0x5a82,  0x5a82,  0x5a82,  0x5a82,
+    0x7d8a,  0x6a6d,  0x471c,  0x18f8, -0x18f9, -0x471d, -0x6a6e, -0x7d8b,
+    0x7641,  0x30fb, -0x30fc, -0x7642, -0x7642, -0x30fc,  0x30fb,  0x7641,
+    0x6a6d, -0x18f9, -0x7d8b, -0x471d,  0x471c,  0x7d8a,  0x18f8, -0x6a6e,
+    0x5a82, -0x5a83, -0x5a83,  0x5a82,  0x5a82, -0x5a83, -0x5a83,  0x5a82,
+    0x471c, -0x7d8b,  0x18f8,  0x6a6d, -0x6a6e, -0x18f9,  0x7d8a, -0x471d,
+    0x30fb, -0x7642,  0x7641, -0x30fc, -0x30fc,  0x7641, -0x7642,  0x30fb,
+    0x18f8, -0x471d,  0x6a6d, -0x7d8b,  0x7d8a, -0x6a6e,  0x471c, -0x18f9
+};
+
+static bool _initialized = false;
+
+static void mdec_send_words(const void *data, int count)
+{
+    const uint32_t *words = (const uint32_t *) data;
+
+    for (int i = 0; i < count; i++) {
+        while (MDEC1 & MDEC_STAT_DATA_FULL)
+            __asm__ volatile("");
+
+        MDEC0 = words[i];
+    }
+}
+
+void mdec_init(void)
+{
+    DMA_DPCR |= (DMA_DPCR_ENABLE << (DMA_MDEC_IN * 4)) | (DMA_DPCR_ENABLE << (DMA_MDEC_OUT * 4));
+
+    MDEC1 = MDEC_CTRL_RESET;
+    MDEC1 = MDEC_CTRL_DMA_IN | MDEC_CTRL_DMA_OUT;
+
+    MDEC0 = MDEC_CMD_SET_QUANT;
+    mdec_send_words(_quant_table, sizeof(_quant_table) / 4);
+    mdec_send_words(_quant_table, sizeof(_quant_table) / 4);
+
+    MDEC0 = MDEC_CMD_SET_SCALE;
+    mdec_send_words(_scale_table, sizeof(_scale_table) / 4);
+
+    _initialized = true;
+}
+
+bool mdec_is_image(const void *data)
+{
+    return !memcmp(((const MDEC_IMAGE_HEADER *) data)->magic, "MDEC", 4);
+}
+
+bool mdec_decode_to_vram(const MDEC_IMAGE_HEADER *image, int x, int y)
+{
+    if (!_initialized)
+        mdec_init();
+
+    if ((image->width % 16) || (image->height % 16) || (image->length % DMA_BLOCK_SIZE)) {
+        printf("MDEC image has an invalid size.");
+        return false;
+    }
+
+    // Each column is decoded into one of two buffers while the other one is
+    // being uploaded to VRAM. In 15bpp mode the MDEC outputs each macroblock
+    // as 16x16 pixels in scanline order, so a column of macroblocks can be
+    // uploaded as is.
+    size_t columnWords = (16 * image->height) / 2;
+    uint32_t *buffers = (uint32_t *) malloc(columnWords * 4 * 2);
+    if (!buffers)
+        return false;
+
+    // The MDEC stalls once its output FIFO is full, so the whole bitstream can
+    // be sent in one go.
+    dma_wait_channel(DMA_MDEC_IN);
+    MDEC0 = MDEC_CMD_DECODE | image->length;
+
+    dma_queue(DMA_MDEC_IN, &image[1], DMA_BLOCK_SIZE | ((image->length / DMA_BLOCK_SIZE) << 16), DMA_CHCR_WRITE | DMA_CHCR_MODE_SLICE | DMA_CHCR_ENABLE);
+
+    bool ok = true;
+    DMA_FENCE uploads[2] = { dma_get_fence(DMA_GPU), dma_get_fence(DMA_GPU) };
+
+    for (int column = 0; column < image->width / 16; column++) {
+        uint32_t *buffer = &buffers[(column & 1) * columnWords];
+
+        // The buffer may still be uploading from two columns ago
+        dma_wait(uploads[column & 1]);
+
+        DMA_FENCE decoded = dma_queue(DMA_MDEC_OUT, buffer, DMA_BLOCK_SIZE | ((columnWords / DMA_BLOCK_SIZE) << 16), DMA_CHCR_READ | DMA_CHCR_MODE_SLICE | DMA_CHCR_ENABLE);
+
+        if (!dma_wait(decoded)) {
+            printf("MDEC timed out.");
+            ok = false;
+            break;
+        }
+
+        uploads[column & 1] = vram_send_data(buffer, x + column * 16, y, 16, image->height);
+    }
+
+    dma_wait_channel(DMA_GPU);
+
+    if (!ok) {
+        // Stopping the channels lets the DMA manager retire the transfers
+        // that will never finish
+        DMA_CHCR(DMA_MDEC_IN) = 0;
+        DMA_CHCR(DMA_MDEC_OUT) = 0;
+        MDEC1 = MDEC_CTRL_RESET;
+        _initialized = false;
+    }
+
+    free(buffers);
+    return ok;
+}
@@ -0,0 +1,108 @@
+#include "psbw/AnimatedSprite.h"
+
+#include <ps1/gpucmd.h>
+
+#include "draw.h"
+
+#include "psbw/GameObject.h"
+#include "psbw/Manager.h"
+
+AnimatedSprite::AnimatedSprite(AnimationFrame* frames, int numFrames, int ticksPerFrame) {
+    // A failed Scene::getAnimation() lookup gives nullptr, the sprite then
+    // just doesn't draw anything
+    _frames = frames;
+    _numFrames = (frames && numFrames > 0) ? numFrames : 0;
+    this->ticksPerFrame = (ticksPerFrame > 0) ? ticksPerFrame : 1;
+    _stoppedFrame = 0;
+
+    play();
+}
+
+void AnimatedSprite::play() {
+    _startTick = psbw_get_tick_count();
+    _playing = true;
+}
+
+void AnimatedSprite::stop() {
+    _stoppedFrame = getFrame();
+    _playing = false;
+}
+
+void AnimatedSprite::setFrame(int frame) {
+    if(frame < 0) {
+        frame = 0;
+    }
+    else if(frame >= _numFrames) {
+        frame = (_numFrames > 0) ? (_numFrames - 1) : 0;
+    }
+
+    _stoppedFrame = frame;
+    _playing = false;
+}
+
+int AnimatedSprite::getFrame() {
+    if(!_playing || !_numFrames) {
+        return _stoppedFrame;
+    }
+
+    // The current frame is worked out from the tick count rather than being
+    // advanced every tick, so nothing has to be done while it's playing.
+    // ticksPerFrame is public, so it's checked here rather than only once.
+    int frame = (psbw_get_tick_count() - _startTick) / ((ticksPerFrame > 0) ? ticksPerFrame : 1);
+
+    if(loop) {
+        return frame % _numFrames;
+    }
+    return (frame < _numFrames) ? frame : (_numFrames - 1);
+}
+
+bool AnimatedSprite::isPlaying() {
+    return _playing;
+}
+
+void AnimatedSprite::execute(GameObject* parent) {
+    if(!_numFrames) {
+        return;
+    }
+
+    AnimationFrame *frame = &_frames[getFrame()];
+
+    Rect bounds;
+    if(!_getScreenBounds(parent, frame, &bounds)) {
+        return;
+    }
+
+    uint32_t* ptr = dma_get_chain_pointer(5, zIndex);
+    ptr[0] = gp0_texpage(frame->page, false, false);
+    ptr[1] = gp0_rectangle(true, true, false);
+    ptr[2] = gp0_xy(bounds.x, bounds.y);
+    ptr[3] = gp0_uv(frame->u, frame->v, frame->clut);
+    ptr[4] = gp0_xy(frame->width, frame->height);
+}
+
+bool AnimatedSprite::getBounds(GameObject* parent, Rect* bounds) {
+    if(!_numFrames) {
+        *bounds = { 0, 0, 0, 0 };
+        return true;
+    }
+
+    _getScreenBounds(parent, &_frames[getFrame()], bounds);
+    return true;
+}
+
+// Returns false if the frame is entirely off screen
+bool AnimatedSprite::_getScreenBounds(GameObject* parent, AnimationFrame* frame, Rect* bounds) {
+    bounds->x = parent->position.x+Component::relPos.x+frame->xMargin;
+    bounds->y = parent->position.y+Component::relPos.y+frame->yMargin;
+    bounds->width = frame->width;
+    bounds->height = frame->height;
+    return rect_to_screen(bounds, screenSpace);
+}
+
+uint32_t AnimatedSprite::getStateHash() {
+    if(!_numFrames) {
+        return 0;
+    }
+
+    return (uint32_t) &_frames[getFrame()];
+}
@@ -0,0 +1,36 @@
+#include "psbw/Collider.h"
+
+#include "collision.h"
+
+Collider::Collider(GameObject *owner, int width, int height) {
+    _owner = owner;
+    Collider::width = width;
+    Collider::height = height;
+    _cellX0 = _cellY0 = _cellX1 = _cellY1 = 0;
+}
+
+Collider::~Collider() {
+    collision_remove(this);
+}
+
+GameObject *Collider::getOwner() {
+    return _owner;
+}
+
+Rect Collider::getRect() {
+    return {
+        _owner->position.x + relPos.x,
+        _owner->position.y + relPos.y,
+        width,
+        height
+    };
+}
+
+bool Collider::overlaps(Collider *other) {
+    Rect a = getRect();
+    Rect b = other->getRect();
+
+    return (a.x < b.x + b.width) && (b.x < a.x + a.width) && (a.y < b.y + b.height) && (b.y < a.y + a.height);
+}
+
+void Collider::execute(GameObject* parent) {}
@@ -40,7 +40,7 @@ static int ctrl_exchange_packet(
 	// time to prepare for incoming bytes so we need a small delay here.
 	IRQ_STAT     = ~(1 << IRQ_SIO0);
 	SIO_CTRL(0) |= SIO_CTRL_DTR | SIO_CTRL_ACKNOWLEDGE;
-	delayMicroseconds(DTR_DELAY);
+	delayMicrosecondsBusy(DTR_DELAY);
 
 	int respLength = 0;
 
@@ -76,7 +76,7 @@ static int ctrl_exchange_packet(
 	}
 
 	// Release DSR, allowing the device to go idle.
-	delayMicroseconds(DTR_DELAY);
+	delayMicrosecondsBusy(DTR_DELAY);
 	SIO_CTRL(0) &= ~SIO_CTRL_DTR;
 
 	return respLength;
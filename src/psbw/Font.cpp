@@ -118,6 +118,42 @@ Font::Font(Texture* texture) {
 	_tex = texture;
 }
 
+void Font::measureString(char *str, int *width, int *height) {
+	int currentX = 0, maxX = 0, lines = 1;
+
+	// Same as printString() but only keeping track of the position.
+	for (; *str; str++) {
+		char ch = *str;
+
+		switch (ch) {
+			case '\t':
+				currentX += FONT_TAB_WIDTH - 1;
+				currentX -= currentX % FONT_TAB_WIDTH;
+				continue;
+
+			case '\n':
+				currentX = 0;
+				lines++;
+				continue;
+
+			case ' ':
+				currentX += FONT_SPACE_WIDTH;
+				continue;
+
+			case '\x80' ... '\xff':
+				ch = '\x7f';
+				break;
+		}
+
+		currentX += fontSprites[ch - FONT_FIRST_TABLE_CHAR].width;
+		if (currentX > maxX)
+			maxX = currentX;
+	}
+
+	*width  = maxX;
+	*height = lines * FONT_LINE_HEIGHT;
+}
+
 void Font::printString(int x, int y, char *str, int zIndex) {
 	int currentX = x, currentY = y;
 
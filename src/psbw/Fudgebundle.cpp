@@ -11,6 +11,8 @@
 #include "draw.h"
 #include "cdrom.h"
 #include "cdread.h"
+#include "lz4.h"
+#include "mdec.h"
 
 #include "psbw/Sound.h"
 
@@ -22,7 +24,23 @@ typedef struct [[gnu::packed]] FDG_BG_HEADER
     uint16_t x,y,width,height;
 } FDG_BG_HEADER;
 
-uint8_t _current_texpage = 10;
+#define VRAM_PAGES 32
+
+// Next page and SPU RAM address to allocate from. Bundles are freed in the
+// reverse order they were loaded, so this works like a stack.
+uint8_t _current_texpage = 0;
+static uint32_t _current_spu_addr = 0x1000;
+
+#define SPU_RAM_END 0x7fff0 // The reverb work area is at the very end
+
+// Loaded bundles in the order they were loaded, and an open addressed hash
+// table (with linear probing) of all their entries. The table is rebuilt
+// whenever a bundle is loaded or freed, which is rare enough that it's not
+// worth supporting removal.
+static Fudgebundle *_loaded_bundles[FDG_MAX_BUNDLES];
+static int _num_loaded_bundles = 0;
+static FDG_REGISTRY_ENTRY *_registry = nullptr;
+static uint32_t _registry_mask = 0;
 
 typedef struct [[gnu::packed]] FDG_TEXTURE_DESCRIPTOR
 {
@@ -43,84 +61,309 @@ typedef struct [[gnu::packed]] FDG_SOUND_DESCRIPTOR
     uint16_t leftOffset, rightOffset, length, sampleRate;
 } FDG_SOUND_DESCRIPTOR;
 
-uint32_t fdg_hash(const char *str) {
-    uint32_t value = 0;
+// Reads the given range of sectors of a file straight into the destination
+// buffer.
+static bool _fudgebundle_read(int lba, int sectors, void *buf) {
+    CdlLOC pos;
+    CdIntToPos(lba, &pos);
+    CdControl(CdlSetloc, &pos, 0);
+    CdRead(sectors, (uint32_t *)buf, CdlModeSpeed);
+    return CdReadSync(0, 0) >= 0;
+}
 
-    while (*str)
-        value = ((uint32_t) *(str++)) + (value << 6) + (value << 16) - value;
+#define SECTORS(length) (((length) + 2047) / 2048)
 
-    return value;
-}
+// Reads the compressed blocks of the first numSections sections of a version 3
+// bundle with a single CdRead() and decompresses each one into its section's
+// buffer as soon as all of its sectors have arrived, so decompression happens
+// while the drive is still reading rather than afterwards.
+static bool _fudgebundle_read_compressed(int lba, const FDG_COMPRESSION_HEADER *header, int numSections, uint8_t **sections, const uint32_t *lengths) {
+    const uint16_t *blockLengths = (const uint16_t *) &header[1];
+    int numBlocks = 0;
+    for (int section = 0; section < numSections; section++)
+        numBlocks += header->numBlocks[section];
+
+    size_t packedLength = 0;
+    for (int i = 0; i < numBlocks; i++)
+        packedLength += blockLengths[i];
+
+    int sectors = SECTORS(packedLength);
+    if (!sectors)
+        return true;
+
+    uint8_t *packed = (uint8_t *) malloc(sectors * 2048);
+
+    CdlLOC pos;
+    CdIntToPos(lba, &pos);
+    CdControl(CdlSetloc, &pos, 0);
+    CdRead(sectors, (uint32_t *) packed, CdlModeSpeed);
+
+    bool ok = true;
+    size_t packedOffset = 0;
+
+    for (int section = 0; section < numSections && ok; section++) {
+        uint8_t *output = sections[section];
+        uint32_t remaining = lengths[section];
+
+        for (int i = 0; i < header->numBlocks[section]; i++) {
+            size_t length = *(blockLengths++);
+            size_t blockEnd = packedOffset + length;
+            uint32_t rawLength = (remaining < header->blockSize) ? remaining : header->blockSize;
+
+            // Wait for the rest of the block to be read.
+            int pending;
+            while ((pending = CdReadSync(1, 0)) > 0) {
+                if ((size_t) (sectors - pending) * 2048 >= blockEnd)
+                    break;
+            }
+            if (pending < 0) {
+                ok = false;
+                break;
+            }
+
+            if (length == rawLength) {
+                memcpy(output, packed + packedOffset, rawLength);
+            }
+            else if (lz4_decompress(packed + packedOffset, length, output, rawLength) != (int) rawLength) {
+                printf("Fudgebundle block %d is corrupted.", i);
+                ok = false;
+                break;
+            }
+
+            packedOffset = blockEnd;
+            output += rawLength;
+            remaining -= rawLength;
+        }
+    }
 
-Fudgebundle::Fudgebundle(char *filename) {
-    CdlFILE file;
-    CdSearchFile(&file, filename);
-    size_t len = (file.size + 2047) & 0xfffff800;
-    void *_ptr = malloc(len);
-    CdControl(CdlSetloc, &(file.pos), 0);
-    CdRead(len / 2048, (uint32_t *)_ptr, CdlModeSpeed);
     if (CdReadSync(0, 0) < 0)
-    {
+        ok = false;
+
+    free(packed);
+    return ok;
+}
+
+// Returns the index-th page that can be used for textures, counting from the
+// given one and skipping pages that overlap the framebuffers (which depend on
+// the resolution of the scene being loaded, unless anyMode is set).
+static int _fudgebundle_page(int first, int index, bool anyMode) {
+    int page = first;
+
+    for (;;) {
+        while (anyMode ? vram_page_is_reserved_in_any_mode(page) : vram_page_is_reserved(page))
+            page++;
+
+        if (!index--)
+            return page;
+
+        page++;
     }
-    _fudgebundle_load((uint8_t*)_ptr);
 }
 
-Fudgebundle::~Fudgebundle() {
-    free(_ram_data);
-    free(_fdg_index);
-    _current_texpage -= _pageCount;
+// Returns the first of count free pages that are next to each other in the
+// same row of VRAM, for data that must be contiguous such as backgrounds.
+static int _fudgebundle_find_pages(int first, int count) {
+    int page = first;
+
+    for (int i = 0; i < count && page < VRAM_PAGES; i++) {
+        if ((page + i) / 16 != page / 16) {
+            page += i;
+            i = -1;
+        }
+        else if (vram_page_is_reserved(page + i)) {
+            page += i + 1;
+            i = -1;
+        }
+    }
+
+    return page;
 }
 
-int Fudgebundle::_fudgebundle_load(uint8_t* data) {
-    _fdg_index = (FDG_INDEX*) data;
+static void _fudgebundle_page_coords(int page, int *x, int *y) {
+    *x = (page % 16) * PAGE_WIDTH;
+    *y = (page / 16) * PAGE_HEIGHT;
+}
+
+Fudgebundle::Fudgebundle(char *filename, bool persistent) {
+    _fdg_index = nullptr;
+    _persistent = persistent;
+    _name = nullptr;
+    _users = 0;
+    _high_resolution = draw_is_high_resolution();
+    _entry_texpage = _current_texpage;
+    _spu_base = _current_spu_addr;
+    _compression = nullptr;
+    _cache = nullptr;
+    _cache_used = 0;
+    _cache_budget = BUNDLE_CACHE_SIZE;
+    _cache_clock = 0;
+    _descriptors = nullptr;
+    _textures = nullptr;
+    _sounds = nullptr;
+    _pageCount = 0;
 
-    // Copy over RAM section
-    uint8_t* temp_ram_data = data+_fdg_index->indexLength+_fdg_index->vramLength+_fdg_index->spuLength;
-    _ram_data = (uint8_t*) malloc(_fdg_index->ramLength);
-    memcpy(_ram_data, temp_ram_data, _fdg_index->ramLength);
+    CdlFILE file;
+    CdSearchFile(&file, filename);
+
+    // Read the first sector to find out how large each section is.
+    uint8_t *data = (uint8_t *) malloc(2048);
+    _file_lba = CdPosToInt(&file.pos);
+    _fudgebundle_read(_file_lba, 1, data);
 
-    if(strncmp(_fdg_index->magic, "fudgebn", 7)) {
+    FDG_INDEX *index = (FDG_INDEX*) data;
+
+    if(strncmp(index->magic, "fudgebn", 7)) {
         printf("Couldn't read fudgebundle magic.");
-        return NULL;
+        free(data);
+        return;
     }
 
-    if(_fdg_index->version != 2) {
-        printf("Only version 2 fudgebundles are supported.");
-        return NULL;
+    if(index->version != 2 && index->version != 3) {
+        printf("Only version 2 and 3 fudgebundles are supported.");
+        free(data);
+        return;
     }
 
+    // Free bundles kept around for earlier scenes if this one wouldn't fit
+    // otherwise, leaving room for a full screen background too.
+    int pages = index->numAtlases256 + index->numAtlases192 + index->numAtlases128 + index->numAtlases64;
+    _fudgebundle_make_room(pages + (SCREEN_WIDTH + PAGE_WIDTH - 1) / PAGE_WIDTH, index->spuLength, persistent);
+
+    // The index, VRAM and SPU sections are only needed while loading, so they
+    // go into a temporary buffer. Entries in the RAM section are read later on,
+    // one at a time, when they're first used.
+    int headSectors = SECTORS(index->indexLength + index->vramLength + index->spuLength);
+
+    data = (uint8_t *) realloc(data, headSectors * 2048);
+    index = (FDG_INDEX*) data;
+
+    if (index->version == 2) {
+        if (headSectors > 1)
+            _fudgebundle_read(_file_lba + 1, headSectors - 1, data + 2048);
+
+        _ram_offset = index->indexLength + index->vramLength + index->spuLength;
+    }
+    else {
+        // Only the index is stored uncompressed, with the block table at its
+        // end.
+        int indexSectors = SECTORS(index->indexLength);
+        if (indexSectors > 1)
+            _fudgebundle_read(_file_lba + 1, indexSectors - 1, data + 2048);
+
+        FDG_COMPRESSION_HEADER *header = (FDG_COMPRESSION_HEADER*) (data + 32 + sizeof(FDG_HASH_ENTRY) * (index->numBuckets + index->numChained));
+        uint8_t *sections[2] = { data + index->indexLength, data + index->indexLength + index->vramLength };
+        uint32_t lengths[2] = { index->vramLength, index->spuLength };
+
+        if (!_fudgebundle_read_compressed(_file_lba + indexSectors, header, 2, sections, lengths))
+            printf("Couldn't read compressed fudgebundle.");
+
+        const uint16_t *blockLengths = (const uint16_t *) &header[1];
+        _ram_offset = indexSectors * 2048;
+        for (int i = 0; i < header->numBlocks[0] + header->numBlocks[1]; i++)
+            _ram_offset += blockLengths[i];
+    }
+
+    _fudgebundle_load(data);
+}
+
+Fudgebundle::~Fudgebundle() {
+    for (int i = 0; i < _num_loaded_bundles; i++) {
+        if (_loaded_bundles[i] == this) {
+            _num_loaded_bundles--;
+            memmove(&_loaded_bundles[i], &_loaded_bundles[i + 1], (_num_loaded_bundles - i) * sizeof(Fudgebundle*));
+            _fudgebundle_rebuild_registry();
+            break;
+        }
+    }
+
+    if (_descriptors) {
+        // Meshes and backgrounds are the only descriptors allocated
+        // individually
+        int numEntries = _fdg_index->numBuckets + _fdg_index->numChained;
+        for (int i = 0; i < numEntries; i++) {
+            if (_hash_table[i].type == 0x0020 || _cache[i].background)
+                free(_descriptors[i]);
+            else if (_hash_table[i].type == 0x0000 && _descriptors[i])
+                delete (BWM*) _descriptors[i];
+        }
+    }
+
+    if (_cache) {
+        int numEntries = _fdg_index->numBuckets + _fdg_index->numChained;
+        for (int i = 0; i < numEntries; i++)
+            free(_cache[i].buffer);
+    }
+
+    free(_cache);
+    free(_descriptors);
+    delete[] _textures;
+    delete[] _sounds;
+    free(_fdg_index);
+    free(_name);
+    _current_texpage = _entry_texpage;
+    _current_spu_addr = _spu_base;
+}
+
+int Fudgebundle::_fudgebundle_load(uint8_t* data) {
+    _fdg_index = (FDG_INDEX*) data;
 
     // Calculate pointer to VRAM data in RAM and the number of pages;
     uint8_t* vram_data = data+_fdg_index->indexLength;
     _pageCount = (_fdg_index->numAtlases256) + (_fdg_index->numAtlases192) +
     + (_fdg_index->numAtlases128) + _fdg_index->numAtlases64;
 
-    // This is for fudgebundle stacking which is sadly broken now
-    _entry_texpage = _current_texpage;
-    _current_texpage = _current_texpage + _pageCount;
+    // Pages are allocated after those of any bundle that's still loaded
+    _entry_texpage = _fudgebundle_page(_current_texpage, 0, _persistent);
+    if (_pageCount)
+        _current_texpage = _fudgebundle_page(_entry_texpage, _pageCount - 1, _persistent) + 1;
+    else
+        _current_texpage = _entry_texpage;
 
-    // Upload data to VRAM
+    if (_current_texpage > VRAM_PAGES)
+        printf("Not enough free VRAM pages for fudgebundle textures.");
+
+    // Upload data to VRAM. The last page is still uploading while the sounds
+    // are being sent to the SPU.
+    DMA_FENCE textures = dma_get_fence(DMA_GPU);
     for(int i = 0; i < _pageCount; i++) {
         uint8_t* currentPage = vram_data+(i*(64*256*sizeof(short)));
-        if(_entry_texpage+i > 15) {
-            vram_send_data(currentPage, ((_entry_texpage+i) % 16)*64, 256, PAGE_WIDTH, PAGE_HEIGHT);
-        }
-        else {
-            vram_send_data(currentPage, ((_entry_texpage+i)*64), 0, PAGE_WIDTH, PAGE_HEIGHT);
-        }
-        waitForDMATransfer(DMA_GPU, 100000);
+        int x, y;
+        _fudgebundle_page_coords(_fudgebundle_page(_entry_texpage, i, _persistent), &x, &y);
+        textures = vram_send_data(currentPage, x, y, PAGE_WIDTH, PAGE_HEIGHT);
     }
 
-    // Upload SPU samples
-    spu_upload(data+_fdg_index->indexLength+_fdg_index->vramLength, _fdg_index->spuLength);
+    // Upload SPU samples after those of any bundle that's still loaded
+    _spu_base = _current_spu_addr;
+    _current_spu_addr += (_fdg_index->spuLength + 63) & ~63;
+
+    if (_current_spu_addr > SPU_RAM_END)
+        printf("Not enough free SPU RAM for fudgebundle sounds.");
+    else if (_fdg_index->spuLength)
+        spu_upload(_spu_base, data+_fdg_index->indexLength+_fdg_index->vramLength, _fdg_index->spuLength);
 
 
     unsigned int indexSize = _fdg_index->indexLength;
     _fdg_index = (FDG_INDEX*) malloc(indexSize);
     memcpy(_fdg_index, data, indexSize);
     _hash_table = (FDG_HASH_ENTRY*) (((uint8_t*)_fdg_index)+32);
+    if (_fdg_index->version == 3)
+        _compression = (FDG_COMPRESSION_HEADER*) &_hash_table[_fdg_index->numBuckets + _fdg_index->numChained];
+    dma_wait(textures);
     free(data); 
 
+    _cache = (FDG_CACHE_ENTRY*) calloc(_fdg_index->numBuckets + _fdg_index->numChained, sizeof(FDG_CACHE_ENTRY));
+
+    _fudgebundle_preload_descriptors();
+    _fudgebundle_decode_entries();
+
+    if (_num_loaded_bundles < FDG_MAX_BUNDLES) {
+        _loaded_bundles[_num_loaded_bundles++] = this;
+        _fudgebundle_rebuild_registry();
+    }
+    else {
+        printf("Too many fudgebundles loaded, assets can only be looked up in their own bundle.");
+    }
+
     return 0;
 }
 
@@ -142,17 +385,401 @@ FDG_HASH_ENTRY *Fudgebundle::_fudgebundle_get_entry(uint32_t hash) {
     return nullptr; // Item not found
 }
 
-Texture *Fudgebundle::fudgebundle_get_texture(uint32_t hash) {
-    FDG_HASH_ENTRY *entry = _fudgebundle_get_entry(hash);
-    if(entry->type != 0x0010) {
-        return NULL;
+void Fudgebundle::_fudgebundle_rebuild_registry() {
+    int numEntries = 0;
+    for (int i = 0; i < _num_loaded_bundles; i++)
+        numEntries += _loaded_bundles[i]->_fdg_index->numBuckets + _loaded_bundles[i]->_fdg_index->numChained;
+
+    // Keep the table at most half full so probe sequences stay short
+    uint32_t size = 16;
+    while (size < (uint32_t) numEntries * 2)
+        size <<= 1;
+
+    free(_registry);
+    _registry = (FDG_REGISTRY_ENTRY*) calloc(size, sizeof(FDG_REGISTRY_ENTRY));
+    _registry_mask = size - 1;
+
+    // Later bundles overwrite entries of earlier ones with the same name.
+    // Bundles only kept around for earlier scenes are left out.
+    for (int i = 0; i < _num_loaded_bundles; i++) {
+        Fudgebundle *bundle = _loaded_bundles[i];
+        if (bundle->_fudgebundle_is_unused())
+            continue;
+
+        int count = bundle->_fdg_index->numBuckets + bundle->_fdg_index->numChained;
+
+        for (int j = 0; j < count; j++) {
+            FDG_HASH_ENTRY *entry = &bundle->_hash_table[j];
+            if (!entry->hash)
+                continue;
+
+            uint32_t slot = entry->hash & _registry_mask;
+            while (_registry[slot].hash && _registry[slot].hash != entry->hash)
+                slot = (slot + 1) & _registry_mask;
+
+            _registry[slot].hash = entry->hash;
+            _registry[slot].bundle = bundle;
+            _registry[slot].entry = entry;
+        }
+    }
+}
+
+bool Fudgebundle::_fudgebundle_is_unused() {
+    return _name && !_users;
+}
+
+uint32_t Fudgebundle::_fudgebundle_ram_usage() {
+    int numEntries = _fdg_index->numBuckets + _fdg_index->numChained;
+    return _fdg_index->indexLength + _cache_used + numEntries * (sizeof(void*) + sizeof(FDG_CACHE_ENTRY));
+}
+
+// Frees unused bundles from the top of the stack until the given number of
+// pages and amount of SPU RAM can be allocated.
+void Fudgebundle::_fudgebundle_make_room(int pages, uint32_t spuLength, bool anyMode) {
+    while (_num_loaded_bundles) {
+        bool vramFits = !pages || _fudgebundle_page(_current_texpage, pages - 1, anyMode) < VRAM_PAGES;
+        bool spuFits = _current_spu_addr + ((spuLength + 63) & ~63) <= SPU_RAM_END;
+
+        Fudgebundle *top = _loaded_bundles[_num_loaded_bundles - 1];
+        if ((vramFits && spuFits) || !top->_fudgebundle_is_unused())
+            return;
+
+        delete top;
+    }
+}
+
+// Frees unused bundles from the top of the stack while they take up more RAM
+// than SCENE_CACHE_SIZE. Unused bundles below one that's still in use can't be
+// freed without leaving a hole in VRAM, so they stay until it's released.
+void Fudgebundle::_fudgebundle_trim_resident() {
+    for (;;) {
+        uint32_t used = 0;
+        for (int i = 0; i < _num_loaded_bundles; i++) {
+            if (_loaded_bundles[i]->_fudgebundle_is_unused())
+                used += _loaded_bundles[i]->_fudgebundle_ram_usage();
+        }
+
+        if (used <= SCENE_CACHE_SIZE || !_num_loaded_bundles)
+            return;
+
+        Fudgebundle *top = _loaded_bundles[_num_loaded_bundles - 1];
+        if (!top->_fudgebundle_is_unused())
+            return;
+
+        delete top;
+    }
+}
+
+Fudgebundle *Fudgebundle::fudgebundle_acquire(char *filename) {
+    bool highRes = draw_is_high_resolution();
+
+    // Bundles loaded for the other resolution may overlap the framebuffers
+    // now, so they (and everything loaded after them) can't be reused
+    for (int i = 0; i < _num_loaded_bundles; i++) {
+        Fudgebundle *bundle = _loaded_bundles[i];
+        if (bundle->_fudgebundle_is_unused() && bundle->_high_resolution != highRes) {
+            while (_num_loaded_bundles > i && _loaded_bundles[_num_loaded_bundles - 1]->_fudgebundle_is_unused())
+                delete _loaded_bundles[_num_loaded_bundles - 1];
+            break;
+        }
+    }
+
+    for (int i = 0; i < _num_loaded_bundles; i++) {
+        Fudgebundle *bundle = _loaded_bundles[i];
+        if (bundle->_name && !strcmp(bundle->_name, filename) && bundle->_high_resolution == highRes) {
+            bundle->_users++;
+            _fudgebundle_rebuild_registry();
+            return bundle;
+        }
+    }
+
+    Fudgebundle *bundle = new Fudgebundle(filename);
+
+    // Bundles that failed to load are freed as soon as they're released
+    if (bundle->_fdg_index) {
+        bundle->_name = strdup(filename);
+        bundle->_users = 1;
+    }
+
+    return bundle;
+}
+
+void Fudgebundle::fudgebundle_release(Fudgebundle *bundle) {
+    if (!bundle)
+        return;
+
+    if (!bundle->_name) {
+        delete bundle;
+        return;
+    }
+
+    if (--bundle->_users > 0)
+        return;
+
+    // Only pinned entries (descriptors and meshes) are worth keeping
+    uint32_t budget = bundle->_cache_budget;
+    bundle->_cache_budget = 0;
+    bundle->_fudgebundle_evict(0);
+    bundle->_cache_budget = budget;
+
+    _fudgebundle_rebuild_registry();
+    _fudgebundle_trim_resident();
+}
+
+int Fudgebundle::fudgebundle_alloc_pages(int count) {
+    for (;;) {
+        int page = _fudgebundle_find_pages(_current_texpage, count);
+        if (page + count <= VRAM_PAGES) {
+            _current_texpage = page + count;
+            return page;
+        }
+
+        if (!_num_loaded_bundles || !_loaded_bundles[_num_loaded_bundles - 1]->_fudgebundle_is_unused())
+            return -1;
+
+        delete _loaded_bundles[_num_loaded_bundles - 1];
+    }
+}
+
+void Fudgebundle::fudgebundle_free_pages(int page) {
+    if (page >= 0 && page < _current_texpage)
+        _current_texpage = page;
+}
+
+FDG_REGISTRY_ENTRY *Fudgebundle::_fudgebundle_registry_find(uint32_t hash) {
+    if (!_registry || !hash)
+        return nullptr;
+
+    uint32_t slot = hash & _registry_mask;
+    while (_registry[slot].hash) {
+        if (_registry[slot].hash == hash)
+            return &_registry[slot];
+
+        slot = (slot + 1) & _registry_mask;
+    }
+
+    return nullptr; // Item not found
+}
+
+// Reads length bytes starting at offset within the RAM section into a new
+// buffer. Only the sectors (or, for compressed bundles, the blocks) covering
+// the range are read.
+bool Fudgebundle::_fudgebundle_read_ram(uint32_t offset, uint32_t length, FDG_CACHE_ENTRY *out) {
+    uint32_t start = offset, end = offset + length;
+    int firstBlock = 0, lastBlock = 0;
+    const uint16_t *blockLengths = nullptr;
+
+    if (_compression) {
+        uint32_t blockSize = _compression->blockSize;
+        blockLengths = (const uint16_t *) &_compression[1] + _compression->numBlocks[0] + _compression->numBlocks[1];
+        firstBlock = offset / blockSize;
+        lastBlock = (end - 1) / blockSize;
+
+        start = 0;
+        for (int i = 0; i < firstBlock; i++)
+            start += blockLengths[i];
+        end = start;
+        for (int i = firstBlock; i <= lastBlock; i++)
+            end += blockLengths[i];
+    }
+
+    start += _ram_offset;
+    end += _ram_offset;
+
+    int sectors = SECTORS(end - (start & ~2047));
+    uint8_t *buffer = (uint8_t *) malloc(sectors * 2048);
+    if (!buffer || !_fudgebundle_read(_file_lba + start / 2048, sectors, buffer)) {
+        free(buffer);
+        return false;
+    }
+
+    if (!_compression) {
+        out->buffer = buffer;
+        out->data = buffer + (start & 2047);
+        out->size = sectors * 2048;
+        return true;
+    }
+
+    uint32_t blockSize = _compression->blockSize;
+    uint32_t rawStart = firstBlock * blockSize;
+    uint32_t rawEnd = (lastBlock + 1) * blockSize;
+    if (rawEnd > _fdg_index->ramLength)
+        rawEnd = _fdg_index->ramLength;
+
+    uint8_t *raw = (uint8_t *) malloc(rawEnd - rawStart);
+    uint8_t *packed = buffer + (start & 2047);
+    uint8_t *output = raw;
+    bool ok = raw != nullptr;
+
+    for (int i = firstBlock; i <= lastBlock && ok; i++) {
+        uint32_t rawLength = (rawEnd - rawStart) - (output - raw);
+        if (rawLength > blockSize)
+            rawLength = blockSize;
+
+        if (blockLengths[i] == rawLength)
+            memcpy(output, packed, rawLength);
+        else if (lz4_decompress(packed, blockLengths[i], output, rawLength) != (int) rawLength)
+            ok = false;
+
+        packed += blockLengths[i];
+        output += rawLength;
+    }
+
+    free(buffer);
+    if (!ok) {
+        printf("Fudgebundle block %d is corrupted.", firstBlock);
+        free(raw);
+        return false;
+    }
+
+    out->buffer = raw;
+    out->data = raw + (offset - rawStart);
+    out->size = rawEnd - rawStart;
+    return true;
+}
+
+// Returns the size of the buffer _fudgebundle_read_ram() ends up keeping for
+// the given range: whole sectors, or whole blocks for compressed bundles.
+uint32_t Fudgebundle::_fudgebundle_read_size(uint32_t offset, uint32_t length) {
+    if (_compression) {
+        uint32_t blockSize = _compression->blockSize;
+        uint32_t rawStart = (offset / blockSize) * blockSize;
+        uint32_t rawEnd = ((offset + length - 1) / blockSize + 1) * blockSize;
+        if (rawEnd > _fdg_index->ramLength)
+            rawEnd = _fdg_index->ramLength;
+
+        return rawEnd - rawStart;
+    }
+
+    uint32_t start = _ram_offset + offset;
+    return SECTORS(start + length - (start & ~2047)) * 2048;
+}
+
+// Frees the least recently used unpinned entries until another needed bytes
+// fit within the cache budget.
+void Fudgebundle::_fudgebundle_evict(uint32_t needed) {
+    int numEntries = _fdg_index->numBuckets + _fdg_index->numChained;
+
+    while (_cache_used + needed > _cache_budget) {
+        FDG_CACHE_ENTRY *oldest = nullptr;
+
+        for (int i = 0; i < numEntries; i++) {
+            FDG_CACHE_ENTRY *cached = &_cache[i];
+            if (cached->buffer && !cached->pins && (!oldest || cached->lastUsed < oldest->lastUsed))
+                oldest = cached;
+        }
+
+        if (!oldest)
+            return; // Everything left is pinned, go over budget
+
+        _cache_used -= oldest->size;
+        free(oldest->buffer);
+        oldest->buffer = nullptr;
+        oldest->data = nullptr;
+    }
+}
+
+// Returns a pointer to an entry's data, reading it from the CD first if it
+// isn't in RAM.
+uint8_t *Fudgebundle::_fudgebundle_get_data(FDG_HASH_ENTRY *entry) {
+    FDG_CACHE_ENTRY *cached = &_cache[entry - _hash_table];
+
+    if (!cached->buffer) {
+        _fudgebundle_evict(_fudgebundle_read_size(entry->offset, entry->length));
+
+        if (!_fudgebundle_read_ram(entry->offset, entry->length, cached)) {
+            printf("Couldn't read fudgebundle entry.");
+            return nullptr;
+        }
+
+        _cache_used += cached->size;
+    }
+
+    cached->lastUsed = ++_cache_clock;
+    return cached->data;
+}
+
+// Texture and sound descriptors are tiny and needed as soon as the bundle is
+// loaded, so they're all read at once and stay pinned. They're usually next to
+// each other, in which case a single read covering all of them is much faster
+// than seeking to each one.
+void Fudgebundle::_fudgebundle_preload_descriptors() {
+    int numEntries = _fdg_index->numBuckets + _fdg_index->numChained;
+    uint32_t start = 0xffffffff, end = 0;
+
+    for (int i = 0; i < numEntries; i++) {
+        FDG_HASH_ENTRY *entry = &_hash_table[i];
+        if (!entry->hash || (entry->type != 0x0010 && entry->type != 0x0030))
+            continue;
+
+        if (entry->offset < start)
+            start = entry->offset;
+        if (entry->offset + entry->length > end)
+            end = entry->offset + entry->length;
     }
 
-    FDG_TEXTURE_DESCRIPTOR *texDesc = (FDG_TEXTURE_DESCRIPTOR*) (_ram_data+entry->offset);
-    FDG_FRAME_DESCRIPTOR *frameDesc = (FDG_FRAME_DESCRIPTOR*) (_ram_data+entry->offset+sizeof(FDG_TEXTURE_DESCRIPTOR));
+    if (start >= end)
+        return;
+
+    FDG_CACHE_ENTRY span;
+    bool haveSpan = (end - start <= 0x10000) && _fudgebundle_read_ram(start, end - start, &span);
+
+    for (int i = 0; i < numEntries; i++) {
+        FDG_HASH_ENTRY *entry = &_hash_table[i];
+        if (!entry->hash || (entry->type != 0x0010 && entry->type != 0x0030))
+            continue;
+
+        FDG_CACHE_ENTRY *cached = &_cache[i];
+        if (haveSpan) {
+            cached->buffer = (uint8_t *) malloc(entry->length);
+            if (!cached->buffer) {
+                printf("Couldn't allocate fudgebundle entry.");
+                continue;
+            }
+
+            cached->data = cached->buffer;
+            cached->size = entry->length;
+            memcpy(cached->buffer, span.data + (entry->offset - start), entry->length);
+        }
+        else if (!_fudgebundle_read_ram(entry->offset, entry->length, cached)) {
+            printf("Couldn't read fudgebundle entry.");
+            continue;
+        }
 
-    Texture *tex = new Texture();
+        cached->pins = 1;
+        _cache_used += cached->size;
+    }
+
+    if (haveSpan)
+        free(span.buffer);
+}
+
+void Fudgebundle::fudgebundle_prefetch(uint32_t hash) {
+    FDG_HASH_ENTRY *entry = _fudgebundle_get_entry(hash);
+    if (entry)
+        _fudgebundle_get_data(entry);
+}
+
+void Fudgebundle::fudgebundle_pin(uint32_t hash) {
+    FDG_HASH_ENTRY *entry = _fudgebundle_get_entry(hash);
+    if (entry && _fudgebundle_get_data(entry))
+        _cache[entry - _hash_table].pins++;
+}
+
+void Fudgebundle::fudgebundle_unpin(uint32_t hash) {
+    FDG_HASH_ENTRY *entry = _fudgebundle_get_entry(hash);
+    if (entry && _cache[entry - _hash_table].pins)
+        _cache[entry - _hash_table].pins--;
+}
 
+void Fudgebundle::fudgebundle_set_cache_budget(uint32_t bytes) {
+    _cache_budget = bytes;
+    _fudgebundle_evict(0);
+}
+
+// Fills in the texture page, UV coordinates and CLUT of a frame given the
+// first page the bundle's textures were uploaded to.
+static void _fudgebundle_resolve_frame(const FDG_FRAME_DESCRIPTOR *frameDesc, int entryTexpage, bool anyMode, Texture *tex) {
     int widthDivider;
     if((frameDesc->frameFlags & 0x3) != 2) {
        widthDivider = ((frameDesc->frameFlags & 0x3) == GP0_COLOR_8BPP) ? 2 : 4;
@@ -165,15 +792,7 @@ Texture *Fudgebundle::fudgebundle_get_texture(uint32_t hash) {
     tex->height = frameDesc->height;
 
     int globalX, globalY;
-
-    if(frameDesc->imagePageIndex <= 6) {
-        globalX = (frameDesc->imagePageIndex+10)*64 + tex->u;
-        globalY = tex->v;
-    }
-    else {
-        globalX = (frameDesc->imagePageIndex-7)*64;
-        globalY = tex->v+256;
-    }
+    _fudgebundle_page_coords(_fudgebundle_page(entryTexpage, frameDesc->imagePageIndex, anyMode), &globalX, &globalY);
 
     uint8_t mode = (frameDesc->frameFlags & 0x3);
 
@@ -201,58 +820,276 @@ Texture *Fudgebundle::fudgebundle_get_texture(uint32_t hash) {
     tex->u = frameDesc->xOffset*widthDivider;
     tex->v = frameDesc->yOffset;
 
-    if(frameDesc->frameFlags & 0x3 == 2) {
+    if((frameDesc->frameFlags & 0x3) == 2) {
         tex->clut = 0;
     }
-    else if((frameDesc->frameFlags & 0x3) == 0 || (frameDesc->frameFlags & 0x3) == 1) {
-        uint16_t pageOffset = ((((_entry_texpage + frameDesc->palletePageIndex)%16)*64) / 16) | ((((_entry_texpage + frameDesc->palletePageIndex) < 16) ? 0 : 64) << 6);
+    else {
+        int paletteX, paletteY;
+        _fudgebundle_page_coords(_fudgebundle_page(entryTexpage, frameDesc->palletePageIndex, anyMode), &paletteX, &paletteY);
+        uint16_t pageOffset = gp0_clut(paletteX / 16, paletteY);
         tex->clut = frameDesc->packedPalleteOffset+pageOffset;
-        for(int j = 1; j < 10000; j++);
     }
     tex->type = frameDesc->frameFlags & 0x3;
+}
+
+void Fudgebundle::_fudgebundle_decode_entries() {
+    int numEntries = _fdg_index->numBuckets + _fdg_index->numChained;
+    int numTextures = 0, numSounds = 0;
+
+    for (int i = 0; i < numEntries; i++) {
+        if (!_hash_table[i].hash)
+            continue;
+
+        if (_hash_table[i].type == 0x0010)
+            numTextures++;
+        else if (_hash_table[i].type == 0x0030)
+            numSounds++;
+    }
+
+    _descriptors = (void**) calloc(numEntries, sizeof(void*));
+    _textures = numTextures ? new Texture[numTextures] : nullptr;
+    _sounds = numSounds ? new Sound[numSounds] : nullptr;
+
+    Texture *tex = _textures;
+    Sound *snd = _sounds;
+
+    for (int i = 0; i < numEntries; i++) {
+        FDG_HASH_ENTRY *entry = &_hash_table[i];
+        if (!entry->hash)
+            continue;
+
+        uint8_t *data = _cache[i].data;
+        if (!data)
+            continue;
+
+        if (entry->type == 0x0010) {
+            FDG_FRAME_DESCRIPTOR *frameDesc = (FDG_FRAME_DESCRIPTOR*) (data+sizeof(FDG_TEXTURE_DESCRIPTOR));
+            _fudgebundle_resolve_frame(frameDesc, _entry_texpage, _persistent, tex);
+            _descriptors[i] = tex++;
+        }
+        else if (entry->type == 0x0030) {
+            FDG_SOUND_DESCRIPTOR *soundDesc = (FDG_SOUND_DESCRIPTOR*) data;
+            // Offsets are relative to the start of the bundle's samples,
+            // Sound::play() assumes those start at 0x1000
+            snd->soundAddr = soundDesc->leftOffset + (_spu_base - 0x1000) / 8;
+            snd->sampleRate = soundDesc->sampleRate;
+            _descriptors[i] = snd++;
+        }
+    }
+}
+
+Texture *Fudgebundle::fudgebundle_get_texture(uint32_t hash) {
+    return _fudgebundle_texture(_fudgebundle_get_entry(hash));
+}
 
-    return tex;
+AnimationFrame *Fudgebundle::fudgebundle_get_animation(uint32_t hash, int *numFrames) {
+    return _fudgebundle_animation(_fudgebundle_get_entry(hash), numFrames);
 }
 
 Sound *Fudgebundle::fudgebundle_get_sound(uint32_t hash) {
-    FDG_SOUND_DESCRIPTOR *soundDesc;
-    FDG_HASH_ENTRY *entry;
-    entry = _fudgebundle_get_entry(hash);
-    soundDesc = (FDG_SOUND_DESCRIPTOR*) (_ram_data+entry->offset);
-    Sound* snd = new Sound();
-    snd->soundAddr = soundDesc->leftOffset;
-    snd->sampleRate = soundDesc->sampleRate;
-    return snd;
+    return _fudgebundle_sound(_fudgebundle_get_entry(hash));
 }
 
 Vector2D *Fudgebundle::fudgebundle_get_background(uint32_t hash) {
-    FDG_HASH_ENTRY *entry;
-    entry = _fudgebundle_get_entry(hash);
+    return _fudgebundle_background(_fudgebundle_get_entry(hash));
+}
+
+BWM* Fudgebundle::fudgebundle_get_mesh(uint32_t hash) {
+    return _fudgebundle_mesh(_fudgebundle_get_entry(hash));
+}
+
+Texture *Fudgebundle::fudgebundle_find_texture(uint32_t hash) {
+    FDG_REGISTRY_ENTRY *found = _fudgebundle_registry_find(hash);
+    return found ? found->bundle->_fudgebundle_texture(found->entry) : nullptr;
+}
+
+AnimationFrame *Fudgebundle::fudgebundle_find_animation(uint32_t hash, int *numFrames) {
+    FDG_REGISTRY_ENTRY *found = _fudgebundle_registry_find(hash);
+    return found ? found->bundle->_fudgebundle_animation(found->entry, numFrames) : nullptr;
+}
+
+Sound *Fudgebundle::fudgebundle_find_sound(uint32_t hash) {
+    FDG_REGISTRY_ENTRY *found = _fudgebundle_registry_find(hash);
+    return found ? found->bundle->_fudgebundle_sound(found->entry) : nullptr;
+}
+
+Vector2D *Fudgebundle::fudgebundle_find_background(uint32_t hash) {
+    FDG_REGISTRY_ENTRY *found = _fudgebundle_registry_find(hash);
+    return found ? found->bundle->_fudgebundle_background(found->entry) : nullptr;
+}
+
+BWM* Fudgebundle::fudgebundle_find_mesh(uint32_t hash) {
+    FDG_REGISTRY_ENTRY *found = _fudgebundle_registry_find(hash);
+    return found ? found->bundle->_fudgebundle_mesh(found->entry) : nullptr;
+}
+
+void Fudgebundle::fudgebundle_find_prefetch(uint32_t hash) {
+    FDG_REGISTRY_ENTRY *found = _fudgebundle_registry_find(hash);
+    if (found)
+        found->bundle->_fudgebundle_get_data(found->entry);
+}
+
+bool Fudgebundle::fudgebundle_find_location(uint32_t hash, int *lba, uint32_t *offset, uint32_t *length) {
+    FDG_REGISTRY_ENTRY *found = _fudgebundle_registry_find(hash);
+    if (!found)
+        return false;
+
+    // Entries of compressed bundles are split across blocks that have to be
+    // decompressed, so they can't be read in arbitrary pieces
+    if (found->bundle->_compression) {
+        printf("Entries of compressed bundles can't be streamed.");
+        return false;
+    }
+
+    uint32_t start = found->bundle->_ram_offset + found->entry->offset;
+    *lba = found->bundle->_file_lba + start / 2048;
+    *offset = start % 2048;
+    *length = found->entry->length;
+    return true;
+}
+
+uint8_t *Fudgebundle::fudgebundle_find_file(uint32_t hash, uint32_t *length) {
+    FDG_REGISTRY_ENTRY *found = _fudgebundle_registry_find(hash);
+    if (!found || found->entry->type != 0x0000)
+        return nullptr;
+
+    Fudgebundle *bundle = found->bundle;
+    uint8_t *data = bundle->_fudgebundle_get_data(found->entry);
+    if (!data)
+        return nullptr;
+
+    bundle->_cache[found->entry - bundle->_hash_table].pins++;
+    *length = found->entry->length;
+    return data;
+}
+
+Texture *Fudgebundle::_fudgebundle_texture(FDG_HASH_ENTRY *entry) {
+    if(entry == nullptr || entry->type != 0x0010) {
+        return nullptr;
+    }
+
+    return (Texture*) _descriptors[entry - _hash_table];
+}
+
+AnimationFrame *Fudgebundle::_fudgebundle_animation(FDG_HASH_ENTRY *entry, int *numFrames) {
+    if(entry == nullptr || entry->type != 0x0010) {
+        return nullptr;
+    }
 
-    FDG_BG_HEADER *header = (FDG_BG_HEADER*)(_ram_data+entry->offset);
+    uint8_t *data = _fudgebundle_get_data(entry);
+    if(data == nullptr) {
+        return nullptr;
+    }
+
+    FDG_TEXTURE_DESCRIPTOR *texDesc = (FDG_TEXTURE_DESCRIPTOR*) data;
+    FDG_FRAME_DESCRIPTOR *frameDescs = (FDG_FRAME_DESCRIPTOR*) (data+sizeof(FDG_TEXTURE_DESCRIPTOR));
+
+    // Each frame is followed by its mipmaps, which are skipped
+    int stride = texDesc->mipmaps ? texDesc->mipmaps : 1;
+
+    AnimationFrame *frames = (AnimationFrame*) malloc(sizeof(AnimationFrame) * texDesc->frames);
+
+    for(int i = 0; i < texDesc->frames; i++) {
+        const FDG_FRAME_DESCRIPTOR *frameDesc = &frameDescs[i * stride];
+        Texture tex;
+        _fudgebundle_resolve_frame(frameDesc, _entry_texpage, _persistent, &tex);
+
+        // Frames are cropped to their contents, the margins tell us where
+        // the cropped frame goes within the full size sprite.
+        frames[i].page = tex.page;
+        frames[i].clut = (tex.type == GP0_COLOR_16BPP) ? 0 : tex.clut;
+        frames[i].u = tex.u;
+        frames[i].v = tex.v;
+        frames[i].width = frameDesc->width;
+        frames[i].height = frameDesc->height;
+        frames[i].xMargin = frameDesc->xMargin;
+        frames[i].yMargin = frameDesc->yMarrgin;
+    }
+
+    *numFrames = texDesc->frames;
+    return frames;
+}
+
+Sound *Fudgebundle::_fudgebundle_sound(FDG_HASH_ENTRY *entry) {
+    if(entry == nullptr || entry->type != 0x0030) {
+        return nullptr;
+    }
+
+    return (Sound*) _descriptors[entry - _hash_table];
+}
+
+Vector2D *Fudgebundle::_fudgebundle_background(FDG_HASH_ENTRY *entry) {
+    // Backgrounds compressed with tools/convertMdec.py are stored as files
+    if(entry == nullptr || (entry->type != 0x0020 && entry->type != 0x0000)) {
+        return nullptr;
+    }
+
+    // Backgrounds stay in VRAM until the bundle is freed, so asking for the
+    // same one again (e.g. from a scene that's reusing the bundle) is free
+    Vector2D **uploaded = (Vector2D**) &_descriptors[entry - _hash_table];
+    if(*uploaded) {
+        return _cache[entry - _hash_table].background || entry->type == 0x0020 ? *uploaded : nullptr;
+    }
+
+    // Backgrounds are only needed until they're in VRAM, so they're left
+    // unpinned for the cache to free whenever it needs the space.
+    uint8_t *data = _fudgebundle_get_data(entry);
+    if(data == nullptr) {
+        return nullptr;
+    }
 
-    // TODO: WASTEFUL!!!
-    if(_current_texpage+5 > 15 && _current_texpage <= 15) {
-        uint8_t pagesToAdd = 16 - _current_texpage;
-        _current_texpage += pagesToAdd;
-        _pageCount += pagesToAdd;
+    bool compressed = (entry->type == 0x0000);
+    if(compressed && !mdec_is_image(data)) {
+        return nullptr;
     }
 
-    unsigned int globalX, globalY;
-    if(_current_texpage <= 15) {
-        globalX = (_current_texpage)*64;
-        globalY = 0;
+    int width, height;
+    if(compressed) {
+        width = ((MDEC_IMAGE_HEADER*)data)->width;
+        height = ((MDEC_IMAGE_HEADER*)data)->height;
     }
     else {
-        globalX = (_current_texpage-16)*64;
-        globalY = 256;
+        width = ((FDG_BG_HEADER*)data)->width;
+        height = ((FDG_BG_HEADER*)data)->height;
     }
 
-    vram_send_data(_ram_data+entry->offset+sizeof(FDG_BG_HEADER), globalX, globalY, header->width, header->height);
+    // Pages are allocated from the top of the stack. Unless this is the most
+    // recently loaded bundle they belong to whichever bundle is, so they can't
+    // be kept for later.
+    while (_num_loaded_bundles && _loaded_bundles[_num_loaded_bundles - 1] != this && _loaded_bundles[_num_loaded_bundles - 1]->_fudgebundle_is_unused())
+        delete _loaded_bundles[_num_loaded_bundles - 1];
 
-    _current_texpage+=5;
-    _pageCount += 5;
+    if (!_num_loaded_bundles || _loaded_bundles[_num_loaded_bundles - 1] != this)
+        uploaded = nullptr;
+
+    // Backgrounds are blitted to the framebuffer in one go so they need a
+    // contiguous area of VRAM.
+    int pages = (width + PAGE_WIDTH - 1) / PAGE_WIDTH;
+    int page = _fudgebundle_find_pages(_current_texpage, pages);
+
+    if (page + pages > VRAM_PAGES) {
+        printf("Not enough free VRAM pages for background.");
+        return nullptr;
+    }
+
+    int globalX, globalY;
+    _fudgebundle_page_coords(page, &globalX, &globalY);
+
+    if(compressed) {
+        if(!mdec_decode_to_vram((MDEC_IMAGE_HEADER*)data, globalX, globalY)) {
+            return nullptr;
+        }
+    }
+    else {
+        dma_wait(vram_send_data(data+sizeof(FDG_BG_HEADER), globalX, globalY, width, height));
+    }
+
+    _current_texpage = page + pages;
     Vector2D *out = (Vector2D*)malloc(sizeof(Vector2D));
+    if (uploaded) {
+        *uploaded = out;
+        _cache[entry - _hash_table].background = compressed;
+    }
 
     out->x = globalX;
     out->y = globalY;
@@ -260,12 +1097,27 @@ Vector2D *Fudgebundle::fudgebundle_get_background(uint32_t hash) {
     return out;
 }
 
-BWM* Fudgebundle::fudgebundle_get_mesh(uint32_t hash) {
-    FDG_HASH_ENTRY *entry;
-    entry = _fudgebundle_get_entry(hash);
+BWM* Fudgebundle::_fudgebundle_mesh(FDG_HASH_ENTRY *entry) {
+    if(entry == nullptr || entry->type != 0x0000) {
+        return nullptr;
+    }
+
+    // Files can be anything, so they're only decoded as meshes on request
+    BWM **cached = (BWM**) &_descriptors[entry - _hash_table];
+    if(*cached) {
+        return _cache[entry - _hash_table].background ? nullptr : *cached;
+    }
+
+    // Meshes point into the entry's data, so it has to stay in RAM
+    uint8_t *data = _fudgebundle_get_data(entry);
+    if(data == nullptr) {
+        return nullptr;
+    }
+    _cache[entry - _hash_table].pins++;
 
     BWM* mesh = new BWM();
-    mesh->header = (BWM_HEADER*) _ram_data+entry->offset;
+    *cached = mesh;
+    mesh->header = (BWM_HEADER*) data;
     mesh->vertices = (BWM_VERTEX*)((uint8_t*)(mesh->header) + sizeof(BWM_HEADER));
     mesh->normals = (BWM_NORMAL*)((uint8_t*)(mesh->vertices) + sizeof(BWM_VERTEX)*mesh->header->numVertices);
     mesh->uvs = (BWM_UV*)((uint8_t*)(mesh->normals) + sizeof(BWM_NORMAL)*mesh->header->numNormals);
@@ -3,6 +3,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "draw.h"
+
 
 GameObject::GameObject(int x, int y, int z) {
     GameObject::position.x = x;
@@ -35,11 +37,49 @@ void GameObject::addComponent(Component *component) {
 
 }
 
-void GameObject::execute() {
+void GameObject::execute(const Rect* clip) {
    
    COMPONENT_ENTRY *entry = &_linked_list;
     while(entry != nullptr) {
-        entry->component->execute(this);
+        // When only part of the screen is being redrawn there's no point in
+        // sending primitives that fall entirely outside of it.
+        Rect bounds;
+        if(clip == nullptr || !entry->component->getBounds(this, &bounds) || rect_overlaps(clip, &bounds)) {
+            entry->component->execute(this);
+        }
         entry = entry->next;
     }
 }
+
+bool GameObject::trackChanges(Rect* dirty) {
+    bool tracked = true;
+
+    COMPONENT_ENTRY *entry = &_linked_list;
+    while(entry != nullptr && entry->component != nullptr) {
+        Component *component = entry->component;
+        Rect bounds;
+
+        if(!component->getBounds(this, &bounds)) {
+            tracked = false;
+            entry = entry->next;
+            continue;
+        }
+
+        uint32_t stateHash = component->getStateHash();
+        Rect *drawn = &component->_drawnBounds;
+
+        // Both where the component was and where it is now have to be redrawn
+        if(bounds.x != drawn->x || bounds.y != drawn->y || bounds.width != drawn->width ||
+            bounds.height != drawn->height || stateHash != component->_drawnStateHash) {
+            rect_add(dirty, drawn);
+            rect_add(dirty, &bounds);
+
+            *drawn = bounds;
+            component->_drawnStateHash = stateHash;
+        }
+
+        entry = entry->next;
+    }
+
+    return tracked;
+}
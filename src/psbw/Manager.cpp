@@ -1,13 +1,45 @@
 #include "psbw/Manager.h"
 
 #include "draw.h"
+#include "gameloop.h"
 
 #include "psbw/Texture.h"
 
+#include <stdio.h>
+
+static Fudgebundle *_commonBundle = nullptr;
+
 void psbw_load_scene(Scene* scene) {
     load_scene(scene);
 }
 
 Scene* psbw_get_active_scene() {
     return get_active_scene();
+}
+
+void psbw_load_common_bundle(char *filename) {
+    // Bundles are freed in the reverse order they were loaded, so the common
+    // one has to be loaded before any scene's
+    if (get_active_scene() != nullptr || _commonBundle != nullptr) {
+        printf("The common bundle must be loaded once, before the first scene.");
+        return;
+    }
+
+    _commonBundle = new Fudgebundle(filename, true);
+}
+
+uint32_t psbw_get_tick_count() {
+    return gameloop_get_tick_count();
+}
+
+int psbw_get_tick_rate() {
+    return gameloop_get_tick_rate();
+}
+
+int psbw_get_refresh_rate() {
+    return draw_get_refresh_rate();
+}
+
+void psbw_set_video_mode(uint8_t mode) {
+    draw_set_graphics_mode(mode);
 }
\ No newline at end of file
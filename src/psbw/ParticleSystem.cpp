@@ -0,0 +1,210 @@
+#include "psbw/ParticleSystem.h"
+
+#include <stdlib.h>
+
+#include <ps1/gpucmd.h>
+#include <ps1/system.h>
+
+#include "draw.h"
+#include "trig.h"
+
+#include "psbw/Manager.h"
+
+#define PARTICLE_SHIFT 8
+
+// Particles this far off screen are removed, which also keeps coordinates
+// within the GPU's 11-bit range
+#define PARTICLE_MARGIN 256
+
+// GP0 packets can't be longer than 255 words
+#define PACKET_MAX_WORDS 255
+
+ParticleSystem::ParticleSystem(int maxParticles) {
+    _max = maxParticles;
+    _count = 0;
+    _lastTick = psbw_get_tick_count();
+
+    // Arrays are ordered by alignment so none of them needs padding
+    size_t size = maxParticles * (4 + 4 + 4 + 2 + 2 + 2 + 2);
+    _pool = malloc(size);
+    if (!_pool) {
+        _max = 0;
+        return;
+    }
+
+    _x = (int32_t *) _pool;
+    _y = &_x[maxParticles];
+    _color = (uint32_t *) &_y[maxParticles];
+    _vx = (int16_t *) &_color[maxParticles];
+    _vy = &_vx[maxParticles];
+    _life = &_vy[maxParticles];
+    _fadeStep = (uint16_t *) &_life[maxParticles];
+}
+
+ParticleSystem::~ParticleSystem() {
+    free(_pool);
+}
+
+void ParticleSystem::emit(int count, int x, int y) {
+    // Bring existing particles up to date so new ones don't get moved by
+    // ticks that passed before they were spawned
+    _update();
+
+    if (count > _max - _count)
+        count = _max - _count;
+
+    uint32_t packedColor = gp0_rgb(color.x, color.y, color.z);
+
+    for (int i = _count; i < _count + count; i++) {
+        int direction = angle + randint(-spread / 2, spread / 2);
+        int velocity = speed + (speedVariance ? randint(0, speedVariance) : 0);
+        int life = lifetime + (lifetimeVariance ? randint(0, lifetimeVariance) : 0);
+
+        if (life < 2)
+            life = 2;
+        if (life > INT16_MAX)
+            life = INT16_MAX;
+
+        _x[i] = x << PARTICLE_SHIFT;
+        _y[i] = y << PARTICLE_SHIFT;
+        // isin() and isin(x + quarter turn) return the sine and cosine in
+        // 20.12 fixed point
+        _vx[i] = (velocity * isin(direction + ISIN_PI / 2)) >> 12;
+        _vy[i] = (velocity * isin(direction)) >> 12;
+        _life[i] = life;
+        _fadeStep[i] = 65536 / life;
+        _color[i] = packedColor;
+    }
+
+    _count += count;
+}
+
+void ParticleSystem::clear() {
+    _count = 0;
+}
+
+int ParticleSystem::getCount() {
+    return _count;
+}
+
+// Returns the world position shown at the top left of the screen
+Vector2D ParticleSystem::_getOrigin() {
+    Scene *scene = psbw_get_active_scene();
+    if (screenSpace || scene == nullptr)
+        return {0, 0};
+
+    return scene->camera2D;
+}
+
+// Advances all particles by the ticks that passed since the last update.
+// Particles are only updated when they're drawn, so when a frame covers
+// several ticks they're moved in one step, which is close enough for effects.
+void ParticleSystem::_update() {
+    uint32_t now = psbw_get_tick_count();
+    int ticks = now - _lastTick;
+    _lastTick = now;
+
+    if (!ticks)
+        return;
+
+    int gravityStep = gravity * ticks;
+    uint32_t rangeX = (draw_get_screen_width() + PARTICLE_MARGIN * 2) << PARTICLE_SHIFT;
+    uint32_t rangeY = (draw_get_screen_height() + PARTICLE_MARGIN * 2) << PARTICLE_SHIFT;
+
+    Vector2D origin = _getOrigin();
+    int32_t minX = (origin.x - PARTICLE_MARGIN) << PARTICLE_SHIFT;
+    int32_t minY = (origin.y - PARTICLE_MARGIN) << PARTICLE_SHIFT;
+
+    for (int i = 0; i < _count;) {
+        int life = _life[i] - ticks;
+        int vy = _vy[i] + gravityStep;
+
+        if (vy > INT16_MAX)
+            vy = INT16_MAX;
+        else if (vy < INT16_MIN)
+            vy = INT16_MIN;
+
+        int32_t x = _x[i] + _vx[i] * ticks;
+        int32_t y = _y[i] + vy * ticks;
+
+        // Dead particles are replaced by the last one, which is then updated
+        // in their place
+        if (
+            life <= 0 ||
+            (uint32_t) (x - minX) >= rangeX ||
+            (uint32_t) (y - minY) >= rangeY
+        ) {
+            _count--;
+            _x[i] = _x[_count];
+            _y[i] = _y[_count];
+            _vx[i] = _vx[_count];
+            _vy[i] = _vy[_count];
+            _life[i] = _life[_count];
+            _fadeStep[i] = _fadeStep[_count];
+            _color[i] = _color[_count];
+            continue;
+        }
+
+        _x[i] = x;
+        _y[i] = y;
+        _vy[i] = vy;
+        _life[i] = life;
+        i++;
+    }
+}
+
+void ParticleSystem::execute(GameObject* parent) {
+    _update();
+
+    bool dot = (size == 1);
+    int wordsPerParticle = dot ? 2 : 3;
+    int perPacket = PACKET_MAX_WORDS / wordsPerParticle;
+
+    // Draw as many particles as there's room for in the chain, keeping two
+    // words for the texpage packet and some for the components drawn later
+    int space = dma_get_chain_space() - 2 - CHAIN_HEADROOM;
+    int fullPackets = space / (perPacket * wordsPerParticle + 1);
+    int remainder = space - fullPackets * (perPacket * wordsPerParticle + 1);
+
+    int count = fullPackets * perPacket + ((remainder > 1) ? (remainder - 1) / wordsPerParticle : 0);
+    if (count > _count)
+        count = _count;
+
+    if (count <= 0)
+        return;
+
+    uint32_t command = dot ? gp0_rectangle1x1(false, false, additive) : gp0_rectangle(false, false, additive);
+    uint32_t dimensions = gp0_xy(size, size);
+
+    Vector2D origin = _getOrigin();
+
+    for (int first = 0; first < count; first += perPacket) {
+        int last = first + perPacket;
+        if (last > count)
+            last = count;
+
+        uint32_t *ptr = dma_get_chain_pointer((last - first) * wordsPerParticle, zIndex);
+
+        for (int i = first; i < last; i++) {
+            uint32_t rgb = _color[i];
+
+            if (fade) {
+                // Red and blue are scaled in one multiplication as the
+                // products can't overlap
+                uint32_t brightness = (_life[i] * _fadeStep[i]) >> 8;
+                rgb = (((rgb & 0xff00ff) * brightness >> 8) & 0xff00ff) | (((rgb & 0x00ff00) * brightness >> 8) & 0x00ff00);
+            }
+
+            *(ptr++) = command | rgb;
+            *(ptr++) = gp0_xy((_x[i] >> PARTICLE_SHIFT) - origin.x, (_y[i] >> PARTICLE_SHIFT) - origin.y);
+            if (!dot)
+                *(ptr++) = dimensions;
+        }
+    }
+
+    // Packets with the same zIndex are sent in the reverse order they were
+    // allocated, so this goes out before the particles. The blend mode of
+    // untextured primitives comes from the current texpage.
+    uint32_t *ptr = dma_get_chain_pointer(1, zIndex);
+    ptr[0] = gp0_texpage(gp0_page(0, 0, additive ? GP0_BLEND_ADD : GP0_BLEND_SEMITRANS, GP0_COLOR_4BPP), false, false);
+}
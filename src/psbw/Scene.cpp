@@ -2,17 +2,20 @@
 
 #include <stdlib.h>
 
+#include "collision.h"
+
 Scene::Scene(char *sceneName) {
     name = sceneName;
     _linked_list.object = nullptr;
 }
 
 void Scene::loadData() {
-    _fdg = new Fudgebundle(name);
+    _fdg = Fudgebundle::fudgebundle_acquire(name);
 }
 
 Scene::~Scene() {
-    delete _fdg;
+    Fudgebundle::fudgebundle_release(_fdg);
+    collision_destroy_world(_collisions);
 
     GAMEOBJECT_ENTRY *entry = &_linked_list;
 
@@ -46,18 +49,63 @@ void Scene::addGameObject(GameObject *object) {
     entry->next = new_entry;
 }
 
+void Scene::addCollider(Collider *collider) {
+    if (_collisions == nullptr)
+        _collisions = collision_create_world();
+
+    if (_collisions != nullptr)
+        collision_add(_collisions, collider);
+}
+
+void Scene::removeCollider(Collider *collider) {
+    if (collider->_world == _collisions)
+        collision_remove(collider);
+}
+
 Texture* Scene::getTexture(char *name) {
-    return _fdg->fudgebundle_get_texture(fdg_hash(name));
+    return Fudgebundle::fudgebundle_find_texture(fdg_hash(name));
+}
+
+AnimationFrame* Scene::getAnimation(char *name, int *numFrames) {
+    return Fudgebundle::fudgebundle_find_animation(fdg_hash(name), numFrames);
 }
 
 Sound* Scene::getSound(char *name) {
-    return _fdg->fudgebundle_get_sound(fdg_hash(name));
+    return Fudgebundle::fudgebundle_find_sound(fdg_hash(name));
 }
 
 void Scene::setBackground(char *name) {
-    backgroundImage = _fdg->fudgebundle_get_background(fdg_hash(name));
+    backgroundImage = Fudgebundle::fudgebundle_find_background(fdg_hash(name));
 }
 
 BWM* Scene::getMesh(char* name) {
-    return _fdg->fudgebundle_get_mesh(fdg_hash(name));
+    return Fudgebundle::fudgebundle_find_mesh(fdg_hash(name));
+}
+
+void Scene::prefetch(char* name) {
+    Fudgebundle::fudgebundle_find_prefetch(fdg_hash(name));
+}
+
+Texture* Scene::getTexture(FDG_NAME name) {
+    return Fudgebundle::fudgebundle_find_texture(name.hash);
+}
+
+AnimationFrame* Scene::getAnimation(FDG_NAME name, int *numFrames) {
+    return Fudgebundle::fudgebundle_find_animation(name.hash, numFrames);
+}
+
+Sound* Scene::getSound(FDG_NAME name) {
+    return Fudgebundle::fudgebundle_find_sound(name.hash);
+}
+
+void Scene::setBackground(FDG_NAME name) {
+    backgroundImage = Fudgebundle::fudgebundle_find_background(name.hash);
+}
+
+BWM* Scene::getMesh(FDG_NAME name) {
+    return Fudgebundle::fudgebundle_find_mesh(name.hash);
+}
+
+void Scene::prefetch(FDG_NAME name) {
+    Fudgebundle::fudgebundle_find_prefetch(name.hash);
 }
\ No newline at end of file
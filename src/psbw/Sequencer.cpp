@@ -0,0 +1,398 @@
+#include "psbw/Sequencer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <ps1/registers.h>
+#include <ps1/system.h>
+#include <vendor/printf.h>
+
+#include "scheduler.h"
+
+#define SEMITONE 256 // Pitch offsets are in 1/256 semitones
+#define OCTAVE (12 * SEMITONE)
+#define MAX_PITCH 0x3fff
+
+#define MAX_VOLUME 0x3fff
+#define VOLUME_DIVISOR (127 * 127 * 127 * 127 / MAX_VOLUME)
+#define CENTER_PAN 64
+
+// 2^(n/12) for each semitone of an octave, in 16.16 fixed point
+static const uint32_t _semitones[13] = {
+    65536, 69433, 73562, 77936, 82570, 87480, 92682,
+    98193, 104032, 110218, 116772, 123715, 131072
+};
+
+Sequencer::Sequencer(FDG_NAME name, int voices) {
+    _init(name.hash, voices);
+}
+
+Sequencer::Sequencer(char *name, int voices) {
+    _init(fdg_hash(name), voices);
+}
+
+void Sequencer::_init(uint32_t hash, int voices) {
+    _header = nullptr;
+    _sounds = nullptr;
+    _voices = nullptr;
+    _numVoices = 0;
+    _spuVoices = 0;
+    _task = -1;
+    _playing = false;
+    _volumeChanged = false;
+    _volume = 127;
+
+    _data = Fudgebundle::fudgebundle_find_file(hash, &_length);
+    if (!_data || _length < sizeof(SEQUENCE_HEADER) || memcmp(_data, "PSEQ", 4)) {
+        printf("Sequence not found or invalid\n");
+        return;
+    }
+
+    const SEQUENCE_HEADER *header = (const SEQUENCE_HEADER*) _data;
+    uint32_t instrumentsEnd = sizeof(SEQUENCE_HEADER) + header->numInstruments * sizeof(SEQUENCE_INSTRUMENT);
+    if (!header->tickRate || header->eventsOffset < instrumentsEnd || header->eventsOffset >= _length) {
+        printf("Invalid sequence\n");
+        return;
+    }
+    if (header->tickRate > SCHEDULER_RATE)
+        printf("Sequence tick rate %d is above SCHEDULER_RATE, it will play slower\n", header->tickRate);
+
+    _spuVoices = spu_reserve_voices(voices);
+    if (!_spuVoices) {
+        printf("Not enough SPU voices for the sequence\n");
+        return;
+    }
+
+    // Missing sounds are reported once here, notes using them are skipped
+    _instruments = (const SEQUENCE_INSTRUMENT*) (_data + sizeof(SEQUENCE_HEADER));
+    _sounds = (Sound**) malloc(header->numInstruments * sizeof(Sound*));
+    for (int i = 0; i < header->numInstruments; i++) {
+        _sounds[i] = Fudgebundle::fudgebundle_find_sound(_instruments[i].sound);
+        if (!_sounds[i])
+            printf("Sound of instrument %d not found\n", i);
+    }
+
+    _voices = (SEQUENCER_VOICE*) malloc(voices * sizeof(SEQUENCER_VOICE));
+    for (int ch = 0; ch < 24; ch++) {
+        if (!(_spuVoices & (1 << ch)))
+            continue;
+
+        SEQUENCER_VOICE *voice = &_voices[_numVoices++];
+        voice->spuVoice = ch;
+        voice->held = false;
+        voice->sound = nullptr;
+        voice->age = 0;
+    }
+
+    _header = header;
+}
+
+Sequencer::~Sequencer() {
+    stop();
+
+    if (_spuVoices)
+        spu_release_voices(_spuVoices);
+
+    free(_sounds);
+    free(_voices);
+}
+
+void Sequencer::play(bool loop) {
+    if (!_header)
+        return;
+
+    stop();
+
+    for (int i = 0; i < SEQUENCE_CHANNELS; i++) {
+        _channels[i].instrument = 0;
+        _channels[i].volume = 127;
+        _channels[i].pan = CENTER_PAN;
+        _channels[i].bend = 0;
+    }
+
+    _loop = loop && _header->loopOffset != SEQUENCE_NO_LOOP;
+    _position = _header->eventsOffset;
+    _wait = _readNumber();
+    _age = 0;
+    _keyOn = 0;
+    _keyOff = 0;
+    _playing = true;
+
+    _task = scheduler_add_task(_tick, this, _header->tickRate);
+    if (_task < 0) {
+        printf("No scheduler task left for the sequence\n");
+        _playing = false;
+    }
+}
+
+void Sequencer::stop() {
+    // Once the task is removed the timer interrupt can't touch anything
+    if (_task >= 0) {
+        scheduler_remove_task(_task);
+        _task = -1;
+    }
+
+    _playing = false;
+    _releaseAll();
+    SPU_FLAG_OFF1 = (uint16_t) _keyOff;
+    SPU_FLAG_OFF2 = (uint16_t) (_keyOff >> 16);
+}
+
+void Sequencer::setVolume(int volume) {
+    if (volume < 0)
+        volume = 0;
+    if (volume > 127)
+        volume = 127;
+
+    _volume = volume;
+    _volumeChanged = true;
+}
+
+bool Sequencer::isPlaying() {
+    return _playing;
+}
+
+// Private API
+
+void Sequencer::_tick(void *arg) {
+    ((Sequencer*) arg)->_update();
+}
+
+void Sequencer::_update() {
+    if (!_playing)
+        return;
+
+    _keyOn = 0;
+    _keyOff = 0;
+    _jumped = false;
+
+    if (_volumeChanged) {
+        _volumeChanged = false;
+        for (int i = 0; i < _numVoices; i++) {
+            if (_voices[i].sound)
+                _setVolume(&_voices[i]);
+        }
+    }
+
+    while (!_wait) {
+        if (!_readEvent()) {
+            _playing = false;
+            _releaseAll();
+            break;
+        }
+
+        _wait = _readNumber();
+    }
+
+    if (_wait)
+        _wait--;
+
+    // All notes of a tick start at the same time. A voice that's restarted
+    // doesn't need keying off, as keying on resets its envelope anyway.
+    _keyOff &= ~_keyOn;
+    if (_keyOff) {
+        SPU_FLAG_OFF1 = (uint16_t) _keyOff;
+        SPU_FLAG_OFF2 = (uint16_t) (_keyOff >> 16);
+    }
+    if (_keyOn) {
+        SPU_FLAG_ON1 = (uint16_t) _keyOn;
+        SPU_FLAG_ON2 = (uint16_t) (_keyOn >> 16);
+    }
+}
+
+// Runs the event at the current position, returns false once the song is over
+bool Sequencer::_readEvent() {
+    if (_position >= _length)
+        return false;
+
+    uint8_t status = _data[_position++];
+    int channel = status & 0xf;
+    SEQUENCER_CHANNEL *state = &_channels[channel];
+
+    // Parameters of truncated events read as 0 rather than past the end
+    uint8_t params[2] = { 0, 0 };
+    int numParams = (status >> 4 == SEQUENCE_NOTE_ON || status >> 4 == SEQUENCE_PITCH_BEND) ? 2 : 1;
+    if (status == 0xff)
+        numParams = 0;
+
+    for (int i = 0; i < numParams && _position < _length; i++)
+        params[i] = _data[_position++];
+
+    switch (status >> 4) {
+        case SEQUENCE_NOTE_OFF:
+            _noteOff(channel, params[0]);
+            break;
+
+        case SEQUENCE_NOTE_ON:
+            _noteOn(channel, params[0], params[1]);
+            break;
+
+        case SEQUENCE_PAN:
+        case SEQUENCE_VOLUME:
+            if (status >> 4 == SEQUENCE_PAN)
+                state->pan = params[0];
+            else
+                state->volume = params[0];
+
+            for (int i = 0; i < _numVoices; i++) {
+                if (_voices[i].sound && _voices[i].channel == channel)
+                    _setVolume(&_voices[i]);
+            }
+            break;
+
+        case SEQUENCE_INSTRUMENT_CHANGE:
+            state->instrument = params[0];
+            break;
+
+        case SEQUENCE_PITCH_BEND:
+            state->bend = (int16_t) (params[0] | (params[1] << 8));
+
+            for (int i = 0; i < _numVoices; i++) {
+                if (_voices[i].sound && _voices[i].channel == channel)
+                    _setPitch(&_voices[i]);
+            }
+            break;
+
+        case SEQUENCE_END:
+            // Looping twice in a tick means the loop takes no time at all,
+            // which would never let the interrupt return
+            if (!_loop || _jumped)
+                return false;
+
+            _position = _header->loopOffset;
+            _jumped = true;
+            break;
+    }
+
+    return true;
+}
+
+// Reads a MIDI style variable-length number (7 bits per byte, most
+// significant first, top bit set on all bytes but the last)
+uint32_t Sequencer::_readNumber() {
+    uint32_t value = 0;
+
+    while (_position < _length) {
+        uint8_t byte = _data[_position++];
+        value = (value << 7) | (byte & 0x7f);
+
+        if (!(byte & 0x80))
+            break;
+    }
+
+    return value;
+}
+
+void Sequencer::_noteOn(int channel, int note, int velocity) {
+    SEQUENCER_CHANNEL *state = &_channels[channel];
+
+    if (!velocity) {
+        _noteOff(channel, note);
+        return;
+    }
+    if (state->instrument >= _header->numInstruments || !_sounds[state->instrument])
+        return;
+
+    SEQUENCER_VOICE *voice = _allocVoice(channel, note);
+    voice->channel = channel;
+    voice->note = note;
+    voice->velocity = velocity;
+    voice->instrument = &_instruments[state->instrument];
+    voice->sound = _sounds[state->instrument];
+    voice->held = true;
+    voice->age = _age++;
+
+    int ch = voice->spuVoice;
+    SPU_CH_ADDR(ch) = voice->sound->soundAddr + 0x0200;
+    SPU_CH_ADSR1(ch) = voice->instrument->adsr1;
+    SPU_CH_ADSR2(ch) = voice->instrument->adsr2;
+    _setPitch(voice);
+    _setVolume(voice);
+
+    _keyOn |= 1 << ch;
+}
+
+void Sequencer::_noteOff(int channel, int note) {
+    for (int i = 0; i < _numVoices; i++) {
+        SEQUENCER_VOICE *voice = &_voices[i];
+
+        if (voice->held && voice->channel == channel && voice->note == note) {
+            voice->held = false;
+            voice->age = _age++;
+            _keyOff |= 1 << voice->spuVoice;
+        }
+    }
+}
+
+// Picks a silent voice if there is one, then the one that was released the
+// longest ago and as a last resort the oldest note still held.
+SEQUENCER_VOICE *Sequencer::_allocVoice(int channel, int note) {
+    SEQUENCER_VOICE *released = nullptr, *held = nullptr;
+
+    for (int i = 0; i < _numVoices; i++) {
+        SEQUENCER_VOICE *voice = &_voices[i];
+
+        // Retriggering a note reuses its voice
+        if (voice->held && voice->channel == channel && voice->note == note)
+            return voice;
+
+        if (voice->held) {
+            if (!held || (int32_t) (voice->age - held->age) < 0)
+                held = voice;
+        }
+        else if (!(_keyOn & (1 << voice->spuVoice))) {
+            if (!SPU_CH_ADSR_VOL(voice->spuVoice))
+                return voice;
+            if (!released || (int32_t) (voice->age - released->age) < 0)
+                released = voice;
+        }
+    }
+
+    return released ? released : held;
+}
+
+// The sound's sample rate is scaled by 2^(offset/12), where offset is the
+// distance from the instrument's base note plus the channel's pitch bend,
+// using the semitone table for the fraction of an octave.
+void Sequencer::_setPitch(SEQUENCER_VOICE *voice) {
+    int offset = (voice->note - voice->instrument->baseNote) * SEMITONE + _channels[voice->channel].bend;
+
+    int octave = (offset >= 0) ? offset / OCTAVE : -((-offset + OCTAVE - 1) / OCTAVE);
+    offset -= octave * OCTAVE;
+
+    int semitone = offset / SEMITONE, fraction = offset % SEMITONE;
+    uint32_t ratio = _semitones[semitone] + (((_semitones[semitone + 1] - _semitones[semitone]) * fraction) >> 8);
+    uint32_t pitch = (voice->sound->sampleRate * ratio) >> 16;
+
+    if (octave >= 0)
+        pitch = (octave > 2) ? MAX_PITCH : pitch << octave;
+    else
+        pitch = (octave < -14) ? 0 : pitch >> -octave;
+
+    SPU_CH_FREQ(voice->spuVoice) = (pitch > MAX_PITCH) ? MAX_PITCH : pitch;
+}
+
+void Sequencer::_setVolume(SEQUENCER_VOICE *voice) {
+    SEQUENCER_CHANNEL *state = &_channels[voice->channel];
+
+    // Instrument, velocity, channel and song volume each go up to 127
+    int volume = (voice->instrument->volume * voice->velocity) * (state->volume * _volume) / VOLUME_DIVISOR;
+    int left = volume, right = volume;
+
+    if (state->pan > CENTER_PAN)
+        left = volume * (127 - state->pan) / (127 - CENTER_PAN);
+    else if (state->pan < CENTER_PAN)
+        right = volume * state->pan / CENTER_PAN;
+
+    SPU_CH_VOL_L(voice->spuVoice) = left;
+    SPU_CH_VOL_R(voice->spuVoice) = right;
+}
+
+void Sequencer::_releaseAll() {
+    _keyOff = 0;
+
+    for (int i = 0; i < _numVoices; i++) {
+        _voices[i].held = false;
+        _keyOff |= 1 << _voices[i].spuVoice;
+    }
+}
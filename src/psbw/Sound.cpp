@@ -5,6 +5,7 @@
 #include "vendor/printf.h"
 
 #include "cdrom.h"
+#include "dma.h"
 
 #define _min(x, y) (((x) < (y)) ? (x) : (y))
 #define getSPUAddr(addr) ((uint16_t)(((addr) + 7) / 8))
@@ -38,6 +39,9 @@ static const uint32_t _dummy_block[4] = {
 
 static int next_sample_addr = 0x1000 + sizeof(_dummy_block);
 
+// Voices used by something else (e.g. the sequencer)
+static uint32_t _reserved_voices = 0;
+
 static void spu_wait_status(uint16_t mask, uint16_t value)
 {
 	for (int i = 0x100000; i; i--)
@@ -56,7 +60,7 @@ static int spu_dma_transfer(uint32_t ramOffset, const void *data, size_t length,
 	// assert(!(length % _DMA_CHUNK_SIZE));
 	length = (length + _DMA_CHUNK_SIZE - 1) / _DMA_CHUNK_SIZE;
 
-	if (!waitForDMATransfer(DMA_SPU, 100000))
+	if (!dma_wait_channel(DMA_SPU))
 		return 0;
 
 	uint16_t ctrlReg = SPU_CTRL & ~SPU_CTRL_XFER_BITMASK;
@@ -69,12 +73,10 @@ static int spu_dma_transfer(uint32_t ramOffset, const void *data, size_t length,
 	SPU_CTRL = ctrlReg | SPU_CTRL_XFER_DMA_WRITE;
 	spu_wait_status(SPU_CTRL_XFER_BITMASK, SPU_CTRL_XFER_DMA_WRITE);
 
-	DMA_MADR(DMA_SPU) = reinterpret_cast<uint32_t>(data);
-	DMA_BCR(DMA_SPU) = _DMA_CHUNK_SIZE | (length << 16);
-	DMA_CHCR(DMA_SPU) = DMA_CHCR_WRITE | DMA_CHCR_MODE_SLICE | DMA_CHCR_ENABLE;
+	DMA_FENCE fence = dma_queue(DMA_SPU, data, _DMA_CHUNK_SIZE | (length << 16), DMA_CHCR_WRITE | DMA_CHCR_MODE_SLICE | DMA_CHCR_ENABLE);
 
 	if (wait)
-		waitForDMATransfer(DMA_SPU, 100000);
+		dma_wait(fence);
 
 	return length * _DMA_CHUNK_SIZE * 4;
 }
@@ -154,7 +156,7 @@ int get_free_channel(void)
 	// Pick a channel whose volume envelope is currently idle
 	for (int ch = 0; ch < 24; ch++)
 	{
-		if (!SPU_CH_ADSR_VOL(ch))
+		if (!(_reserved_voices & (1 << ch)) && !SPU_CH_ADSR_VOL(ch))
 			return ch;
 	}
 #endif
@@ -174,8 +176,36 @@ Sound::Sound()
 {
 }
 
-void spu_upload(const void* data, size_t size) {
-	spu_dma_transfer(0x1000, data, size, true);
+uint32_t spu_reserve_voices(int count)
+{
+	uint32_t voices = 0;
+
+	for (int ch = 23; ch >= 0 && count; ch--)
+	{
+		if (_reserved_voices & (1 << ch))
+			continue;
+
+		voices |= 1 << ch;
+		count--;
+	}
+
+	if (count)
+		return 0;
+
+	// Stop anything Sound::play() left playing on them
+	SpuSetKey(0, voices);
+	_reserved_voices |= voices;
+	return voices;
+}
+
+void spu_release_voices(uint32_t voices)
+{
+	SpuSetKey(0, voices);
+	_reserved_voices &= ~voices;
+}
+
+void spu_upload(uint32_t addr, const void* data, size_t size) {
+	spu_dma_transfer(addr, data, size, true);
 }
 
 void Sound::spu_upload_sample(const void *data)
@@ -204,6 +234,8 @@ void Sound::spu_upload_sample(const void *data)
 void Sound::play()
 {
 	int ch = get_free_channel();
+	if (ch < 0)
+		return;
 
 	// Make sure the channel is stopped.
 	SpuSetKey(0, 1 << ch);
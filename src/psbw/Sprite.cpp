@@ -9,19 +9,25 @@
 #include "psbw/GameObject.h"
 
 void Sprite::execute(GameObject* parent) {
+    // Sprites that are entirely off screen are skipped before any space in
+    // the chain is allocated for them
+    Rect bounds;
+    if(!_getScreenBounds(parent, &bounds)) {
+        return;
+    }
 
     uint32_t* ptr;
     if(Type == SPRITE_TYPE_FLAT_COLOR) {
         ptr = dma_get_chain_pointer(3, zIndex);
         ptr[0] = gp0_rgb(Color.x, Color.y, Color.z) | gp0_rectangle(false, false, false);
-	    ptr[1] = gp0_xy(parent->position.x+Component::relPos.x, parent->position.y+Component::relPos.y);
+	    ptr[1] = gp0_xy(bounds.x, bounds.y);
 	    ptr[2] = gp0_xy(Width, Height);
     }
     else if(Type == SPRITE_TYPE_TEXTURED && tex != nullptr) {
         ptr = dma_get_chain_pointer(5, zIndex);
         ptr[0] = gp0_texpage(tex->page, false, false);
 		ptr[1] = gp0_rectangle(true, true, false);
-		ptr[2] = gp0_xy(parent->position.x, parent->position.y);
+		ptr[2] = gp0_xy(bounds.x, bounds.y);
         if(tex->type == 0 || tex->type == 1) {
  		    ptr[3] = gp0_uv(tex->u, tex->v, tex->clut);
         }
@@ -32,6 +38,38 @@ void Sprite::execute(GameObject* parent) {
     }
 }
 
+bool Sprite::getBounds(GameObject* parent, Rect* bounds) {
+    _getScreenBounds(parent, bounds);
+    return true;
+}
+
+// Returns false if the sprite is off screen or has nothing to draw
+bool Sprite::_getScreenBounds(GameObject* parent, Rect* bounds) {
+    if(Type == SPRITE_TYPE_FLAT_COLOR) {
+        *bounds = {parent->position.x+Component::relPos.x, parent->position.y+Component::relPos.y, Width, Height};
+    }
+    else if(Type == SPRITE_TYPE_TEXTURED && tex != nullptr) {
+        *bounds = {parent->position.x, parent->position.y, tex->width, tex->height};
+    }
+    else {
+        *bounds = {0, 0, 0, 0};
+        return false;
+    }
+    return rect_to_screen(bounds, screenSpace);
+}
+
+uint32_t Sprite::getStateHash() {
+    uint32_t hash = Type;
+    hash = hash * 31 + (Color.x | (Color.y << 8) | (Color.z << 16));
+
+    if(tex != nullptr) {
+        hash = hash * 31 + (uint32_t) tex;
+        hash = hash * 31 + (tex->u | (tex->v << 8) | (tex->clut << 16));
+        hash = hash * 31 + tex->page;
+    }
+    return hash;
+}
+
 Sprite::Sprite(SpriteType type) {
     Color.x = 255;
     Color.y = 255;
@@ -2,10 +2,41 @@
 
 #include "psbw/Font.h"
 
+#include "draw.h"
+
 void Text::setFont(Font* font) {
     _fnt = font;
 }
 
 void Text::execute(GameObject* parent) {
-    _fnt->printString(parent->position.x+Component::relPos.x, parent->position.y+Component::relPos.y, text, zIndex);
+    Rect bounds = {parent->position.x+Component::relPos.x, parent->position.y+Component::relPos.y, 0, 0};
+
+    // Measuring the text to cull it is only worth it for text that moves with
+    // the camera. HUD text is nearly always on screen
+    if(screenSpace) {
+        _fnt->printString(bounds.x, bounds.y, text, zIndex);
+        return;
+    }
+
+    _fnt->measureString(text, &bounds.width, &bounds.height);
+    if(rect_to_screen(&bounds, false)) {
+        _fnt->printString(bounds.x, bounds.y, text, zIndex);
+    }
+}
+
+bool Text::getBounds(GameObject* parent, Rect* bounds) {
+    bounds->x = parent->position.x+Component::relPos.x;
+    bounds->y = parent->position.y+Component::relPos.y;
+    _fnt->measureString(text, &bounds->width, &bounds->height);
+    rect_to_screen(bounds, screenSpace);
+    return true;
+}
+
+uint32_t Text::getStateHash() {
+    // The text is often a buffer that gets overwritten with sprintf() so the
+    // contents have to be hashed rather than the pointer
+    uint32_t hash = (uint32_t) _fnt;
+    for(char *ch = text; *ch; ch++)
+        hash = hash * 31 + (uint8_t) *ch;
+    return hash;
 }
\ No newline at end of file
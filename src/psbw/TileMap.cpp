@@ -0,0 +1,412 @@
+#include "psbw/TileMap.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <ps1/gpucmd.h>
+
+#include "draw.h"
+#include "cdrom.h"
+#include "cdread.h"
+
+#include "psbw/GameObject.h"
+#include "psbw/Manager.h"
+
+#define TILE_SHIFT 4
+#define CHUNK_SHIFT 5
+#define CHUNK_BYTES (TILEMAP_CHUNK_TILES * TILEMAP_CHUNK_TILES * 2)
+
+#define TILE_BYTES (TILE_SIZE * TILE_SIZE * 2)
+#define TILES_PER_SECTOR (2048 / TILE_BYTES)
+
+#define TILEMAP_NO_SLOT 0xffff
+
+// GP0 packets can't be longer than 255 words
+#define PACKET_MAX_WORDS 255
+
+// Chunks around the camera in the order they're loaded, closest first
+static const int8_t _load_order[TILEMAP_WINDOW * TILEMAP_WINDOW][2] = {
+    { 0,  0}, {-1,  0}, { 1,  0}, { 0, -1}, { 0,  1},
+    {-1, -1}, { 1, -1}, {-1,  1}, { 1,  1}
+};
+
+// Sends the words gathered so far as a single packet, if it fits in the chain
+static bool _flush(uint32_t *words, int *count, int zIndex) {
+    if (!*count)
+        return true;
+
+    // Two words are kept for the texpage packet sent after the tiles and some
+    // for the components drawn later
+    if (dma_get_chain_space() < *count + 1 + 2 + CHAIN_HEADROOM)
+        return false;
+
+    uint32_t *ptr = dma_get_chain_pointer(*count, zIndex);
+    memcpy(ptr, words, *count * 4);
+    *count = 0;
+    return true;
+}
+
+TileMap::TileMap(FDG_NAME name, int cachePages) {
+    _valid = false;
+    _reading = false;
+    _readChunk = nullptr;
+    _readGroup = 0;
+    _frame = 0;
+    _centerX = 0;
+    _centerY = 0;
+    _page = -1;
+    _numPages = 0;
+    _numSlots = 0;
+    _tileSlots = nullptr;
+    _slotTiles = nullptr;
+    _slotUsed = nullptr;
+    _wanted = nullptr;
+
+    for (int i = 0; i < TILEMAP_WINDOW * TILEMAP_WINDOW; i++) {
+        _chunks[i].x = -1;
+        _chunks[i].y = -1;
+        _chunks[i].ready = false;
+    }
+
+    _buffer = (uint32_t *) malloc(2048 * 2);
+
+    uint32_t length;
+    if (!_buffer || !Fudgebundle::fudgebundle_find_location(name.hash, &_lba, &_offset, &length)) {
+        printf("Couldn't find tile map.");
+        return;
+    }
+
+    // The header is small enough that reading it right away doesn't matter
+    if (!_startRead(0) || CdReadSync(0, 0) < 0) {
+        _reading = false;
+        printf("Couldn't read tile map.");
+        return;
+    }
+    _reading = false;
+
+    memcpy(&_header, (uint8_t *) _buffer + _offset, sizeof(TILEMAP_HEADER));
+    if (memcmp(_header.magic, "TMAP", 4)) {
+        printf("Couldn't read tile map magic.");
+        return;
+    }
+
+    // A 16bpp texpage is 256 pixels wide, so the whole cache can be drawn
+    // from without switching texpages
+    if (cachePages < 1)
+        cachePages = 1;
+    if (cachePages > 4)
+        cachePages = 4;
+
+    _page = Fudgebundle::fudgebundle_alloc_pages(cachePages);
+    if (_page < 0) {
+        printf("Not enough free VRAM pages for tile map.");
+        return;
+    }
+
+    _numPages = cachePages;
+    _numSlots = cachePages * (64 / TILE_SIZE) * (256 / TILE_SIZE);
+    _texpage = gp0_page(_page % 16, _page / 16, GP0_BLEND_SEMITRANS, GP0_COLOR_16BPP);
+
+    _tileSlots = (uint16_t *) malloc(_header.numTiles * 2);
+    _slotTiles = (uint16_t *) malloc(_numSlots * 2);
+    _slotUsed = (uint32_t *) calloc(_numSlots, 4);
+    _wanted = (uint32_t *) calloc((_header.numTiles + 31) / 32, 4);
+
+    if (!_tileSlots || !_slotTiles || !_slotUsed || !_wanted)
+        return;
+
+    memset(_tileSlots, 0xff, _header.numTiles * 2);
+    memset(_slotTiles, 0xff, _numSlots * 2);
+
+    _valid = true;
+}
+
+TileMap::~TileMap() {
+    sync();
+
+    free(_buffer);
+    free(_tileSlots);
+    free(_slotTiles);
+    free(_slotUsed);
+    free(_wanted);
+
+    Fudgebundle::fudgebundle_free_pages(_page);
+}
+
+int TileMap::getWidth() {
+    return _valid ? _header.width : 0;
+}
+
+int TileMap::getHeight() {
+    return _valid ? _header.height : 0;
+}
+
+TILEMAP_CHUNK *TileMap::_getChunk(int x, int y) {
+    if (x < 0 || y < 0 || x >= _header.chunksWide || y >= _header.chunksHigh)
+        return nullptr;
+
+    TILEMAP_CHUNK *chunk = &_chunks[(y % TILEMAP_WINDOW) * TILEMAP_WINDOW + (x % TILEMAP_WINDOW)];
+    if (chunk->x != x || chunk->y != y || !chunk->ready)
+        return nullptr;
+
+    return chunk;
+}
+
+int TileMap::getTile(int x, int y) {
+    if (!_valid)
+        return 0;
+
+    TILEMAP_CHUNK *chunk = _getChunk(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT);
+    if (!chunk)
+        return 0;
+
+    return chunk->tiles[(y & (TILEMAP_CHUNK_TILES - 1)) * TILEMAP_CHUNK_TILES + (x & (TILEMAP_CHUNK_TILES - 1))];
+}
+
+bool TileMap::isReady() {
+    if (!_valid || _reading)
+        return false;
+
+    for (int i = 0; i < TILEMAP_WINDOW * TILEMAP_WINDOW; i++) {
+        int x = _centerX + _load_order[i][0];
+        int y = _centerY + _load_order[i][1];
+
+        if (x >= 0 && y >= 0 && x < _header.chunksWide && y < _header.chunksHigh && !_getChunk(x, y))
+            return false;
+    }
+
+    for (int i = 0; i < (_header.numTiles + 31) / 32; i++) {
+        if (_wanted[i])
+            return false;
+    }
+
+    return true;
+}
+
+void TileMap::sync() {
+    if (!_reading)
+        return;
+
+    _finishRead(CdReadSync(0, 0) >= 0);
+}
+
+// Starts reading the sectors covering 2048 bytes at the given offset into the
+// tile map. Everything read is a multiple of 2048 bytes from the start, so it
+// always starts _offset bytes into the buffer.
+bool TileMap::_startRead(uint32_t offset) {
+    uint32_t start = _offset + offset;
+
+    CdlLOC pos;
+    CdIntToPos(_lba + start / 2048, &pos);
+    CdControl(CdlSetloc, &pos, 0);
+
+    if (!CdRead(_offset ? 2 : 1, _buffer, CdlModeSpeed))
+        return false;
+
+    _reading = true;
+    return true;
+}
+
+void TileMap::_finishRead(bool ok) {
+    _reading = false;
+    uint8_t *data = (uint8_t *) _buffer + _offset;
+
+    if (_readChunk) {
+        if (ok) {
+            memcpy(_readChunk->tiles, data, CHUNK_BYTES);
+            _readChunk->ready = true;
+        }
+        else {
+            _readChunk->x = -1;
+        }
+        return;
+    }
+
+    // Tiles that didn't make it stay wanted and are read again later
+    if (!ok)
+        return;
+
+    DMA_FENCE uploaded = dma_get_fence(DMA_GPU);
+
+    for (int i = 0; i < TILES_PER_SECTOR; i++) {
+        int tile = _readGroup * TILES_PER_SECTOR + i;
+        if (tile >= _header.numTiles)
+            break;
+        if (!(_wanted[tile / 32] & (1 << (tile % 32))))
+            continue;
+
+        int slot = _allocSlot();
+        if (slot < 0)
+            break;
+
+        int slotsWide = _numPages * (64 / TILE_SIZE);
+        int x = (_page % 16) * 64 + (slot % slotsWide) * TILE_SIZE;
+        int y = (_page / 16) * 256 + (slot / slotsWide) * TILE_SIZE;
+        uploaded = vram_send_data(&data[i * TILE_BYTES], x, y, TILE_SIZE, TILE_SIZE);
+
+        _tileSlots[tile] = slot;
+        _slotTiles[slot] = tile;
+        _slotUsed[slot] = _frame;
+        _wanted[tile / 32] &= ~(1 << (tile % 32));
+    }
+
+    // The buffer is reused by the next read
+    dma_wait(uploaded);
+}
+
+// Starts the next read, if there's anything left to read. Chunks around the
+// camera come first, then the graphics of visible tiles that aren't in VRAM.
+void TileMap::_requestNext() {
+    for (int i = 0; i < TILEMAP_WINDOW * TILEMAP_WINDOW; i++) {
+        int x = _centerX + _load_order[i][0];
+        int y = _centerY + _load_order[i][1];
+
+        if (x < 0 || y < 0 || x >= _header.chunksWide || y >= _header.chunksHigh)
+            continue;
+
+        TILEMAP_CHUNK *chunk = &_chunks[(y % TILEMAP_WINDOW) * TILEMAP_WINDOW + (x % TILEMAP_WINDOW)];
+        if (chunk->x == x && chunk->y == y)
+            continue;
+
+        chunk->x = x;
+        chunk->y = y;
+        chunk->ready = false;
+        _readChunk = chunk;
+
+        if (!_startRead(2048 * (1 + y * _header.chunksWide + x)))
+            chunk->x = -1;
+        return;
+    }
+
+    for (int i = 0; i < (_header.numTiles + 31) / 32; i++) {
+        if (!_wanted[i])
+            continue;
+
+        int tile = i * 32 + __builtin_ctz(_wanted[i]);
+        _readChunk = nullptr;
+        _readGroup = tile / TILES_PER_SECTOR;
+        _startRead(_header.tilesOffset + _readGroup * 2048);
+        return;
+    }
+}
+
+void TileMap::_want(int tile) {
+    _wanted[tile / 32] |= 1 << (tile % 32);
+}
+
+// Returns a free slot, or the least recently drawn one that wasn't drawn in
+// the current or the previous frame. Reads finish at the start of execute(),
+// before anything is drawn, so the previous frame's tiles are the ones still
+// on screen. Returns -1 if every slot is on screen.
+int TileMap::_allocSlot() {
+    int best = -1;
+    uint32_t oldest = 0xffffffff;
+
+    for (int slot = 0; slot < _numSlots; slot++) {
+        if (_slotTiles[slot] == TILEMAP_NO_SLOT)
+            return slot;
+
+        if (_frame - _slotUsed[slot] > 1 && _slotUsed[slot] < oldest) {
+            oldest = _slotUsed[slot];
+            best = slot;
+        }
+    }
+
+    if (best >= 0)
+        _tileSlots[_slotTiles[best]] = TILEMAP_NO_SLOT;
+
+    return best;
+}
+
+void TileMap::execute(GameObject* parent) {
+    if (!_valid)
+        return;
+
+    _frame++;
+
+    // Top left corner of the screen in pixels from the map's origin
+    int left = -(parent->position.x + Component::relPos.x);
+    int top = -(parent->position.y + Component::relPos.y);
+
+    Scene *scene = psbw_get_active_scene();
+    if (!screenSpace && scene != nullptr) {
+        left += scene->camera2D.x;
+        top += scene->camera2D.y;
+    }
+
+    int width = draw_get_screen_width();
+    int height = draw_get_screen_height();
+
+    _centerX = (left + width / 2) >> (TILE_SHIFT + CHUNK_SHIFT);
+    _centerY = (top + height / 2) >> (TILE_SHIFT + CHUNK_SHIFT);
+
+    // Only one read is in flight at a time. Checking on it once per frame is
+    // plenty, as a sector takes about 7 ms to arrive.
+    if (_reading) {
+        int pending = CdReadSync(1, 0);
+        if (pending <= 0)
+            _finishRead(pending == 0);
+    }
+    if (!_reading)
+        _requestNext();
+
+    int firstX = left >> TILE_SHIFT, lastX = (left + width - 1) >> TILE_SHIFT;
+    int firstY = top >> TILE_SHIFT, lastY = (top + height - 1) >> TILE_SHIFT;
+
+    if (firstX < 0)
+        firstX = 0;
+    if (firstY < 0)
+        firstY = 0;
+    if (lastX >= _header.width)
+        lastX = _header.width - 1;
+    if (lastY >= _header.height)
+        lastY = _header.height - 1;
+
+    uint32_t command = gp0_rectangle16x16(true, true, false);
+    int slotsWide = _numPages * (64 / TILE_SIZE);
+
+    // Tiles are gathered into packets as large as the GPU allows, as empty
+    // and missing tiles make it impossible to know the size up front
+    uint32_t words[PACKET_MAX_WORDS];
+    int count = 0;
+    bool drawn = false, full = false;
+
+    for (int y = firstY; y <= lastY && !full; y++) {
+        for (int x = firstX; x <= lastX; x++) {
+            int tile = getTile(x, y);
+            if (!tile || tile > _header.numTiles)
+                continue;
+
+            tile--;
+            int slot = _tileSlots[tile];
+            if (slot == TILEMAP_NO_SLOT) {
+                _want(tile);
+                continue;
+            }
+            _slotUsed[slot] = _frame;
+
+            if (count + 3 > PACKET_MAX_WORDS) {
+                if (!_flush(words, &count, zIndex)) {
+                    full = true;
+                    break;
+                }
+                drawn = true;
+            }
+
+            words[count++] = command;
+            words[count++] = gp0_xy((x << TILE_SHIFT) - left, (y << TILE_SHIFT) - top);
+            words[count++] = gp0_uv((slot % slotsWide) * TILE_SIZE, (slot / slotsWide) * TILE_SIZE, 0);
+        }
+    }
+
+    if (!full && count && _flush(words, &count, zIndex))
+        drawn = true;
+
+    // Packets with the same zIndex are sent in the reverse order they were
+    // allocated, so this goes out before the tiles
+    if (drawn) {
+        uint32_t *ptr = dma_get_chain_pointer(1, zIndex);
+        ptr[0] = gp0_texpage(_texpage, false, false);
+    }
+}
@@ -0,0 +1,261 @@
+#include "psbw/VideoPlayer.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <ps1/registers.h>
+
+#include "cdrom.h"
+#include "cdstream.h"
+#include "mdec.h"
+
+#include "psbw/Manager.h"
+
+#define VIDEO_MAGIC 0x0160
+#define VIDEO_VERSION 0
+#define VIDEO_CHUNK_SIZE 2304 // Bitstream bytes per sector
+
+// Enough to ride out a frame that takes a few ticks to decode at 2x speed
+#define VIDEO_RING_SLOTS 16
+
+#define VIDEO_MAX_HEIGHT 256 // Frames can't cross into the next row of pages
+
+// Header at the start of every video sector, written by
+// tools/convertVideo.py. Sectors with a different magic are padding.
+typedef struct [[gnu::packed]] VIDEO_SECTOR_HEADER
+{
+    uint16_t magic;
+    uint8_t fps;
+    uint8_t version;
+    uint16_t chunk, numChunks; // Index of this sector within the frame
+    uint32_t frame;
+    uint32_t length; // Length of the frame's bitstream in 32-bit words
+    uint16_t width, height;
+} VIDEO_SECTOR_HEADER;
+
+VideoPlayer::VideoPlayer(char *filename, Scene *next) : Scene(filename) {
+    _next = next;
+    _playing = false;
+    _ring = nullptr;
+    _pages = -1;
+    _back = 0;
+    _back_ready = false;
+    _frame = nullptr;
+    _frame_size = 0;
+    _frame_number = -1;
+    _frame_chunks = 0;
+    _shown = -1;
+    _ready_frame = -1;
+    _fps = 0;
+    _start_tick = 0;
+}
+
+// Videos don't come with a bundle
+void VideoPlayer::loadData() {
+    _fdg = nullptr;
+}
+
+void VideoPlayer::sceneSetup() {
+    // Both buffers have to be in the same row as the blit to the framebuffer
+    // can't wrap around. They're allocated after any bundle that's still
+    // resident (freeing unused ones if needed) and released before the next
+    // scene is loaded.
+    int pagesPerBuffer = (SCREEN_WIDTH + 63) / 64;
+    _pages = Fudgebundle::fudgebundle_alloc_pages(pagesPerBuffer * 2);
+    if (_pages < 0) {
+        printf("Not enough free VRAM pages for video.");
+        return;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        int page = _pages + pagesPerBuffer * i;
+        _buffers[i].x = (page % 16) * 64;
+        _buffers[i].y = (page / 16) * 256;
+    }
+
+    CdlFILE file;
+    if (!CdSearchFile(&file, name)) {
+        printf("Couldn't find video %s.", name);
+        return;
+    }
+
+    _ring = (CdlStreamSector *) malloc(sizeof(CdlStreamSector) * VIDEO_RING_SLOTS);
+    if (!_ring)
+        return;
+
+    // Only the audio track on file 1, channel 0 is played. Audio sectors are
+    // sent to the SPU by the drive and never show up in the ring buffer.
+    CdlFILTER filter = { 1, 0, 0 };
+    CdCommand(CdlSetfilter, (const uint8_t *) &filter, 2, 0);
+
+    CdlATV mix = { 0x80, 0x00, 0x80, 0x00 };
+    CdMix(&mix);
+
+    _old_cd_volume[0] = SPU_CDDA_VOL_L;
+    _old_cd_volume[1] = SPU_CDDA_VOL_R;
+    SPU_CDDA_VOL_L = 0x7fff;
+    SPU_CDDA_VOL_R = 0x7fff;
+
+    // The stream is stopped if the ring buffer fills up, which would also
+    // interrupt the audio, so sectors must be taken out every tick.
+    int sectors = (file.size + 2047) / 2048;
+    if (!CdStreamStart(&file.pos, sectors, _ring, VIDEO_RING_SLOTS, CdlModeSpeed | CdlModeRT | CdlModeSF)) {
+        printf("Couldn't start streaming video %s.", name);
+        return;
+    }
+
+    _start_tick = psbw_get_tick_count();
+    _playing = true;
+}
+
+void VideoPlayer::sceneLoop() {
+    if (!_playing) {
+        _finish();
+        return;
+    }
+
+    int pending = CdStreamSync();
+    if (pending < 0) {
+        printf("Error while streaming video %s.", name);
+        _finish();
+        return;
+    }
+
+    // Frame n is fully read n + 1 frame periods after the stream starts, which
+    // is also when its audio has been played. Swapping buffers here means the
+    // frame shows up in the next draw.
+    if (_back_ready && _fps) {
+        uint32_t due = _start_tick + ((_ready_frame + 1) * TICK_RATE) / _fps;
+
+        if (psbw_get_tick_count() >= due) {
+            backgroundImage = &_buffers[_back];
+            _back ^= 1;
+            _back_ready = false;
+            _shown = _ready_frame;
+        }
+    }
+
+    // Sectors are left in the ring buffer while the back buffer holds a frame
+    // that isn't shown yet, as there's nowhere to decode the next one to.
+    while (!_back_ready) {
+        CdlStreamSector *sector = CdStreamGetSector();
+        if (!sector)
+            break;
+
+        bool ok = !(sector->info.submode & CdlSubmodeForm2) || _receive(sector->data);
+        CdStreamRelease();
+
+        if (!ok) {
+            printf("Video %s is corrupted.", name);
+            _finish();
+            return;
+        }
+    }
+
+    if (!pending && !_back_ready)
+        _finish();
+}
+
+// Returns false if the header can't be from tools/convertVideo.py. Every
+// sector is checked before anything in it is used, as a single bad header
+// would otherwise be enough to divide by zero or decode past the buffers.
+static bool _check_header(const VIDEO_SECTOR_HEADER *header, int fps) {
+    if (header->version != VIDEO_VERSION || !header->fps || (fps && header->fps != fps))
+        return false;
+    if (!header->numChunks || header->chunk >= header->numChunks)
+        return false;
+    if (!header->width || !header->height || header->width > SCREEN_WIDTH || header->height > VIDEO_MAX_HEIGHT)
+        return false;
+
+    return header->length && header->length <= (uint32_t) header->numChunks * (VIDEO_CHUNK_SIZE / 4);
+}
+
+// Returns false if the video is corrupted and playback has to end
+bool VideoPlayer::_receive(const uint32_t *data) {
+    const VIDEO_SECTOR_HEADER *header = (const VIDEO_SECTOR_HEADER *) data;
+    if (header->magic != VIDEO_MAGIC)
+        return true;
+    if (!_check_header(header, _fps))
+        return false;
+
+    // The frame rate is set by the first frame's header and never changes
+    _fps = header->fps;
+
+    // A frame whose sectors weren't all read (e.g. due to a read error) is
+    // dropped once the next one starts.
+    if ((int) header->frame != _frame_number) {
+        uint32_t size = sizeof(MDEC_IMAGE_HEADER) + header->numChunks * VIDEO_CHUNK_SIZE;
+        if (size > _frame_size) {
+            uint8_t *frame = (uint8_t *) realloc(_frame, size);
+            if (!frame)
+                return true;
+
+            _frame = frame;
+            _frame_size = size;
+        }
+
+        MDEC_IMAGE_HEADER *image = (MDEC_IMAGE_HEADER *) _frame;
+        memcpy(image->magic, "MDEC", 4);
+        image->width = header->width;
+        image->height = header->height;
+        image->length = header->length;
+
+        _frame_number = header->frame;
+        _frame_chunks = 0;
+    }
+
+    // Sectors of the same frame have to agree on its size
+    uint32_t end = sizeof(MDEC_IMAGE_HEADER) + (header->chunk + 1) * VIDEO_CHUNK_SIZE;
+    if (end > _frame_size)
+        return false;
+
+    memcpy(&_frame[end - VIDEO_CHUNK_SIZE], &header[1], VIDEO_CHUNK_SIZE);
+
+    if (++_frame_chunks < header->numChunks)
+        return true;
+
+    // Frames that would be shown after the next one is due are skipped so the
+    // video stays in sync with the audio
+    uint32_t late = _start_tick + ((_frame_number + 2) * TICK_RATE) / _fps;
+    if (psbw_get_tick_count() >= late)
+        return true;
+
+    MDEC_IMAGE_HEADER *image = (MDEC_IMAGE_HEADER *) _frame;
+    if (mdec_decode_to_vram(image, _buffers[_back].x, _buffers[_back].y)) {
+        _back_ready = true;
+        _ready_frame = _frame_number;
+    }
+    return true;
+}
+
+void VideoPlayer::stop() {
+    _playing = false;
+}
+
+int VideoPlayer::getFrame() {
+    return _shown;
+}
+
+// Releases everything before the next scene is loaded, since scenes are
+// deleted through a Scene pointer.
+void VideoPlayer::_finish() {
+    if (_ring) {
+        CdStreamStop();
+
+        SPU_CDDA_VOL_L = _old_cd_volume[0];
+        SPU_CDDA_VOL_R = _old_cd_volume[1];
+
+        free(_ring);
+        _ring = nullptr;
+    }
+
+    free(_frame);
+    _frame = nullptr;
+
+    backgroundImage = nullptr;
+    Fudgebundle::fudgebundle_free_pages(_pages);
+    _pages = -1;
+
+    psbw_load_scene(_next);
+}
@@ -0,0 +1,142 @@
+#include "scheduler.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <ps1/registers.h>
+#include <ps1/system.h>
+
+#include "interrupts.h"
+
+// Timer 2 can only count the CPU clock divided by 8 and its counter is 16
+// bits wide, which limits how slow the base rate can be. Slower tasks are
+// still fine as they skip ticks.
+#define TIMER_CLOCK (33868800 / 8)
+#define TIMER_PERIOD (TIMER_CLOCK / SCHEDULER_RATE)
+
+#if TIMER_PERIOD > 0xffff
+#error "SCHEDULER_RATE must be at least 65 Hz"
+#endif
+
+typedef struct {
+    SchedulerTask task;
+    void *arg;
+    int rate;
+    int accumulator;
+    SCHEDULER_TASK_STATS stats;
+} TASK;
+
+static TASK _tasks[SCHEDULER_MAX_TASKS];
+static int _num_tasks;
+static SCHEDULER_STATS _stats;
+
+// Each tick adds the task's rate to its accumulator and the task runs every
+// time it reaches SCHEDULER_RATE, the same way the game loop turns vblanks
+// into ticks, so any rate up to SCHEDULER_RATE works without drifting.
+static void _timer_handler(void) {
+    // The counter restarts when it reaches the period, so its value is how
+    // long ago the interrupt fired
+    uint16_t latency = TIMER_VALUE(2);
+
+    // Reading the control register clears its "reached target" flag, which
+    // tells whether the next tick came due while the tasks were running
+    (void) TIMER_CTRL(2);
+
+    _stats.ticks++;
+    _stats.lastLatency = latency;
+    if (latency > _stats.maxLatency)
+        _stats.maxLatency = latency;
+
+    for (int i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+        TASK *task = &_tasks[i];
+        if (!task->task)
+            continue;
+
+        task->accumulator += task->rate;
+        if (task->accumulator < SCHEDULER_RATE)
+            continue;
+        task->accumulator -= SCHEDULER_RATE;
+
+        uint16_t start = TIMER_VALUE(2);
+        task->task(task->arg);
+        uint16_t time = (TIMER_VALUE(2) - start + TIMER_PERIOD) % TIMER_PERIOD;
+
+        task->stats.runs++;
+        task->stats.lastTime = time;
+        if (time > task->stats.maxTime)
+            task->stats.maxTime = time;
+    }
+
+    if (TIMER_CTRL(2) & TIMER_CTRL_RELOADED)
+        _stats.overruns++;
+}
+
+void scheduler_init() {
+    _num_tasks = 0;
+    scheduler_reset_stats();
+
+    TIMER_CTRL(2) = 0;
+    TIMER_RELOAD(2) = TIMER_PERIOD;
+    TIMER_CTRL(2) = TIMER_CTRL_RELOAD | TIMER_CTRL_IRQ_ON_RELOAD | TIMER_CTRL_IRQ_REPEAT | TIMER_CTRL_PRESCALE;
+}
+
+int scheduler_add_task(SchedulerTask task, void *arg, int rate) {
+    if (rate < 1)
+        rate = 1;
+    if (rate > SCHEDULER_RATE)
+        rate = SCHEDULER_RATE;
+
+    for (int i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+        if (_tasks[i].task)
+            continue;
+
+        bool enable = disableInterrupts();
+
+        _tasks[i].arg = arg;
+        _tasks[i].rate = rate;
+        _tasks[i].accumulator = 0;
+        _tasks[i].stats.runs = 0;
+        _tasks[i].stats.lastTime = 0;
+        _tasks[i].stats.maxTime = 0;
+        _tasks[i].task = task;
+
+        // The timer interrupt is only unmasked while there are tasks
+        if (!_num_tasks++)
+            interrupt_add_handler(IRQ_TIMER2, _timer_handler);
+
+        if (enable)
+            enableInterrupts();
+        return i;
+    }
+
+    return -1;
+}
+
+void scheduler_remove_task(int handle) {
+    if (handle < 0 || handle >= SCHEDULER_MAX_TASKS || !_tasks[handle].task)
+        return;
+
+    bool enable = disableInterrupts();
+
+    _tasks[handle].task = (SchedulerTask) 0;
+    if (!--_num_tasks)
+        interrupt_remove_handler(IRQ_TIMER2, _timer_handler);
+
+    if (enable)
+        enableInterrupts();
+}
+
+const SCHEDULER_TASK_STATS *scheduler_get_task_stats(int handle) {
+    return &_tasks[handle].stats;
+}
+
+const SCHEDULER_STATS *scheduler_get_stats() {
+    return &_stats;
+}
+
+void scheduler_reset_stats() {
+    _stats.ticks = 0;
+    _stats.overruns = 0;
+    _stats.lastLatency = 0;
+    _stats.maxLatency = 0;
+}
@@ -9,14 +9,28 @@
 
 #define VSYNC_TIMEOUT	0x100000
 
+// Idle tasks are only started if at least this many scanlines (about 1 ms)
+// are left before the next vblank, so a chunk can't make VSync() miss it
+#define IDLE_MARGIN_LINES 16
+
 static volatile uint32_t _vblank_counter, _last_vblank;
-static volatile uint16_t _last_hblank;
+static volatile uint16_t _last_hblank, _vblank_hblank;
+
+typedef struct {
+	IdleTask task;
+	void *arg;
+} IDLE_ENTRY;
+
+static IDLE_ENTRY _idle_tasks[VSYNC_MAX_IDLE_TASKS];
+static int _next_idle_task;
+static bool _in_idle_task;
 
 static void (*_vsync_callback)(void)    = (void *) 0;
 
 
 static void _vblank_handler(void) {
 	_vblank_counter++;
+	_vblank_hblank = TIMER_VALUE(1);
 
 	if (_vsync_callback)
 		_vsync_callback();
@@ -34,12 +48,66 @@ void vsync_init() {
     _vblank_counter = 0;
 	_last_vblank    = 0;
 	_last_hblank    = 0;
+
+	// Count scanlines with timer 1 to know how much of the frame is left
+	TIMER_CTRL(1) = TIMER_CTRL_EXT_CLOCK;
+
     GPU_GP1 = 0x02000000;
     interrupt_install_callback(IRQ_VSYNC, &_vblank_handler);
 }
 
 static void (*_vsync_halt_func)(void)   = &_default_vsync_halt;
 
+// Runs one chunk of the next idle task if there's time for it before the
+// vblank, otherwise waits for the vblank as usual. Tasks take turns so a long
+// one can't starve the others.
+static void _vsync_idle(void) {
+	int lines = ((GPU_GP1 & GP1_STAT_MODE_BITMASK) == GP1_STAT_MODE_PAL) ? 314 : 263;
+	int elapsed = (uint16_t) (TIMER_VALUE(1) - _vblank_hblank);
+
+	// Tasks that call VSync() themselves just wait
+	if (!_in_idle_task && elapsed < lines - IDLE_MARGIN_LINES) {
+		for (int i = 0; i < VSYNC_MAX_IDLE_TASKS; i++) {
+			int index = (_next_idle_task + i) % VSYNC_MAX_IDLE_TASKS;
+			IDLE_ENTRY *entry = &_idle_tasks[index];
+			if (!entry->task)
+				continue;
+
+			_next_idle_task = (index + 1) % VSYNC_MAX_IDLE_TASKS;
+
+			_in_idle_task = true;
+			bool done = entry->task(entry->arg);
+			_in_idle_task = false;
+
+			if (done)
+				entry->task = (IdleTask) 0;
+			return;
+		}
+	}
+
+	_vsync_halt_func();
+}
+
+bool vsync_add_idle_task(IdleTask task, void *arg) {
+	for (int i = 0; i < VSYNC_MAX_IDLE_TASKS; i++) {
+		if (_idle_tasks[i].task)
+			continue;
+
+		_idle_tasks[i].arg  = arg;
+		_idle_tasks[i].task = task;
+		return true;
+	}
+
+	return false;
+}
+
+void vsync_remove_idle_task(IdleTask task, void *arg) {
+	for (int i = 0; i < VSYNC_MAX_IDLE_TASKS; i++) {
+		if (_idle_tasks[i].task == task && _idle_tasks[i].arg == arg)
+			_idle_tasks[i].task = (IdleTask) 0;
+	}
+}
+
 
 int VSync(int mode) {
 	uint16_t delta = (TIMER_VALUE(1) - _last_hblank) & 0xffff;
@@ -55,7 +123,7 @@ int VSync(int mode) {
 
 	while (_vblank_counter < target) {
 		uint32_t status = GPU_GP1;
-		_vsync_halt_func();
+		_vsync_idle();
 
 		// If interlaced mode is enabled, wait until the GPU starts displaying
 		// the next field.
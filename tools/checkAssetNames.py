@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""Fudgebundle asset name checker
+
+Scans game source files for asset names hashed at compile time (string
+literals with the _fdg suffix, e.g. "font"_fdg) and makes sure each of them is
+defined in the bundle the scene using it loads, so that typos and assets
+looked up in the wrong bundle are caught when building rather than when the
+lookup fails on the console. Also warns about names within the same bundle
+whose hashes collide.
+
+Scenes are matched to bundles by looking for scenes created with a literal
+file name (e.g. new MainMenu("\\MENU.FDG")). The bundle's JSON file must have
+the same name (menu.json), and source files belong to the scene their name
+matches (MainMenu.cpp). Names from bundles loaded with
+psbw_load_common_bundle() are valid everywhere. Names in any other source file,
+or in a scene whose bundle can't be worked out, only have to be defined in
+some bundle.
+"""
+
+__version__ = "0.1.0"
+
+import json, re, sys
+from argparse import ArgumentParser, Namespace
+from pathlib  import Path
+from typing   import Iterable
+
+SOURCE_EXTENSIONS: tuple[str, ...] = ( ".c", ".cpp", ".h", ".hpp" )
+NAME_REGEX: re.Pattern = re.compile(r'"((?:[^"\\]|\\.)*)"_fdg\b')
+
+# Bundle file names as written in C string literals, e.g. "\\MENU.FDG;1".
+BUNDLE_PATH: str = r'"(?:\\\\)?(?:[^"\\]*\\\\)*([^"\\;]+)\.FDG(?:;\d+)?"'
+
+SCENE_REGEX:  re.Pattern = re.compile(
+	r"\bnew\s+(\w+)\s*\(\s*" + BUNDLE_PATH, re.IGNORECASE
+)
+COMMON_REGEX: re.Pattern = re.compile(
+	r"\bpsbw_load_common_bundle\s*\(\s*" + BUNDLE_PATH, re.IGNORECASE
+)
+## Hashing
+
+# Must match fdg_hash() in inc/psbw/Fudgebundle.h.
+def fdgHash(name: str) -> int:
+	value: int = 0
+
+	for char in name.encode("ascii"):
+		value = (char + (value << 6) + (value << 16) - value) & 0xffffffff
+
+	return value
+
+## Scanning
+
+def findFiles(paths: Iterable[Path], extensions: tuple[str, ...]) -> list[Path]:
+	files: list[Path] = []
+
+	for path in paths:
+		if path.is_dir():
+			files.extend(
+				_file for _file in sorted(path.rglob("*"))
+				if _file.suffix.lower() in extensions
+			)
+		else:
+			files.append(path)
+
+	return files
+
+# Returns the names defined by each bundle, by the lowercase name of its JSON
+# file. JSON files with the same name (e.g. in different asset folders) are
+# treated as versions of the same bundle.
+def loadBundleNames(jsonFiles: Iterable[Path]) -> dict[str, set[str]]:
+	bundles: dict[str, set[str]] = {}
+
+	for path in jsonFiles:
+		names: set[str] = bundles.setdefault(path.stem.lower(), set())
+
+		with open(path, "rt", encoding = "utf-8") as _file:
+			entries: list[dict] = json.load(_file)
+
+		hashes: dict[int, str] = {}
+
+		for entry in entries:
+			name:  str = entry["name"]
+			_hash: int = fdgHash(name)
+
+			if _hash in hashes and hashes[_hash] != name:
+				print(
+					f"{path}: warning: '{name}' and '{hashes[_hash]}' have "
+					f"the same hash ({_hash:08x})",
+					file = sys.stderr
+				)
+
+			hashes[_hash] = name
+			names.add(name)
+
+	return bundles
+
+def findSceneBundles(sourceFiles: Iterable[Path]) -> tuple[dict[str, set[str]], set[str]]:
+	scenes: dict[str, set[str]] = {}
+	common: set[str]            = set()
+
+	for path in sourceFiles:
+		with open(path, "rt", encoding = "utf-8", errors = "replace") as _file:
+			source: str = _file.read()
+
+		for match in SCENE_REGEX.finditer(source):
+			scenes.setdefault(match.group(1), set()).add(match.group(2).lower())
+		for match in COMMON_REGEX.finditer(source):
+			common.add(match.group(1).lower())
+
+	return scenes, common
+
+## Main
+
+def createParser() -> ArgumentParser:
+	parser = ArgumentParser(
+		description = \
+			"Checks that every \"name\"_fdg literal in the given source files "
+			"is defined in the fudgebundle JSON file of the bundle its scene "
+			"loads.",
+		epilog      = \
+			"Scenes are matched to bundles through scenes created with a "
+			"literal file name (new MainMenu(\"\\\\MENU.FDG\") uses menu.json) "
+			"and source files to scenes by name (MainMenu.cpp). Names in "
+			"other files, or in scenes whose bundle can't be found this way, "
+			"are only checked against all bundles at once.",
+		add_help    = False
+	)
+
+	group = parser.add_argument_group("Tool options")
+	group.add_argument(
+		"-h", "--help",
+		action = "help",
+		help   = "Show this help message and exit"
+	)
+
+	group = parser.add_argument_group("Input options")
+	group.add_argument(
+		"-a", "--assets",
+		type     = Path,
+		action   = "append",
+		required = True,
+		help     = \
+			"Fudgebundle JSON file or directory to search for them (can be "
+			"specified multiple times)",
+		metavar  = "path"
+	)
+	group.add_argument(
+		"sources",
+		type  = Path,
+		nargs = "+",
+		help  = "Source files or directories to scan"
+	)
+
+	return parser
+
+def main():
+	parser: ArgumentParser = createParser()
+	args:   Namespace      = parser.parse_args()
+
+	bundles:     dict[str, set[str]] = loadBundleNames(findFiles(args.assets, ( ".json", )))
+	sourceFiles: list[Path]          = findFiles(args.sources, SOURCE_EXTENSIONS)
+	missing:     int                 = 0
+
+	scenes, common = findSceneBundles(sourceFiles)
+	allNames:    set[str]            = set().union(*bundles.values())
+	commonNames: set[str]            = set().union(
+		*( bundles.get(bundle, set()) for bundle in common )
+	)
+
+	for path in sourceFiles:
+		sceneBundles: set[str] = scenes.get(path.stem, set())
+
+		if sceneBundles and all(bundle in bundles for bundle in sceneBundles):
+			names:    set[str] = commonNames.union(
+				*( bundles[bundle] for bundle in sceneBundles )
+			)
+			location: str      = \
+				f"the {path.stem} scene's bundle ({', '.join(sorted(sceneBundles))})"
+		else:
+			names:    set[str] = allNames
+			location: str      = "any bundle"
+
+		with open(path, "rt", encoding = "utf-8", errors = "replace") as _file:
+			for lineNumber, line in enumerate(_file, 1):
+				for match in NAME_REGEX.finditer(line):
+					if match.group(1) in names:
+						continue
+
+					print(
+						f"{path}:{lineNumber}: error: asset '{match.group(1)}' "
+						f"is not defined in {location}",
+						file = sys.stderr
+					)
+					missing += 1
+
+	if missing:
+		sys.exit(1)
+
+if __name__ == "__main__":
+	main()
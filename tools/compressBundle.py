@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""Fudgebundle section compressor
+
+Converts a version 2 fudgebundle into a version 3 one, whose VRAM, SPU and RAM
+sections are split into fixed size blocks each compressed with LZ4. The engine
+decompresses every block as soon as its sectors have been read from the CD, so
+loading takes roughly as long as reading the compressed data. Blocks that don't
+get any smaller are stored as-is. Requires the lz4 package to be installed.
+"""
+
+__version__ = "0.1.0"
+
+from argparse import ArgumentParser, FileType, Namespace
+from struct   import Struct
+
+import lz4.block
+
+## Bundle format
+
+SECTOR_SIZE: int = 2048
+BLOCK_SIZE:  int = 0x8000 # Same as a 64x256 VRAM page
+
+INDEX_STRUCT:       Struct = Struct("< 7s B 4I 4B 2H")
+HASH_ENTRY_STRUCT:  Struct = Struct("< 3I 2H")
+COMPRESSION_STRUCT: Struct = Struct("< I 3H 2x")
+INDEX_MAGIC:        bytes  = b"fudgebn"
+
+def alignToMultiple(data: bytearray, alignment: int):
+	padAmount: int = alignment - (len(data) % alignment)
+
+	if padAmount < alignment:
+		data.extend(b"\0" * padAmount)
+
+def compressSection(data: bytes) -> tuple[list[int], bytearray]:
+	lengths: list[int] = []
+	output:  bytearray = bytearray()
+
+	for offset in range(0, len(data), BLOCK_SIZE):
+		block:  bytes = data[offset:offset + BLOCK_SIZE]
+		packed: bytes = lz4.block.compress(
+			block, mode = "high_compression", compression = 12,
+			store_size = False
+		)
+
+		# The engine treats blocks whose stored length is the same as their
+		# uncompressed length as not being compressed.
+		if len(packed) >= len(block):
+			packed = block
+
+		lengths.append(len(packed))
+		output.extend(packed)
+
+	return lengths, output
+
+## Main
+
+def createParser() -> ArgumentParser:
+	parser = ArgumentParser(
+		description = \
+			"Compresses the data sections of a version 2 fudgebundle, "
+			"producing a version 3 bundle.",
+		add_help    = False
+	)
+
+	group = parser.add_argument_group("Tool options")
+	group.add_argument(
+		"-h", "--help",
+		action = "help",
+		help   = "Show this help message and exit"
+	)
+
+	group = parser.add_argument_group("File paths")
+	group.add_argument(
+		"input",
+		type = FileType("rb"),
+		help = "Path to version 2 bundle to compress"
+	)
+	group.add_argument(
+		"output",
+		type = FileType("wb"),
+		help = "Path to compressed bundle to generate"
+	)
+
+	return parser
+
+def main():
+	parser: ArgumentParser = createParser()
+	args:   Namespace      = parser.parse_args()
+
+	with args.input as _file:
+		bundle: bytes = _file.read()
+
+	(
+		magic, version, indexLength, vramLength, spuLength, ramLength,
+		*numAtlases, numBuckets, numChained
+	) = INDEX_STRUCT.unpack(bundle[0:INDEX_STRUCT.size])
+
+	if magic != INDEX_MAGIC:
+		parser.error("input file is not a fudgebundle")
+	if version != 2:
+		parser.error(f"only version 2 bundles can be compressed (got {version})")
+
+	vramOffset: int = indexLength
+	spuOffset:  int = vramOffset + vramLength
+	ramOffset:  int = spuOffset  + spuLength
+
+	sections: list[tuple[list[int], bytearray]] = [
+		compressSection(bundle[vramOffset:spuOffset]),
+		compressSection(bundle[spuOffset:ramOffset]),
+		compressSection(bundle[ramOffset:ramOffset + ramLength])
+	]
+
+	# The block table goes right after the hash table, at the end of the index
+	# section. The VRAM, SPU and RAM section lengths in the index are left
+	# uncompressed so the engine knows how much memory to allocate.
+	tableOffset: int       = \
+		INDEX_STRUCT.size + HASH_ENTRY_STRUCT.size * (numBuckets + numChained)
+	index:       bytearray = bytearray(bundle[0:tableOffset])
+
+	index.extend(COMPRESSION_STRUCT.pack(
+		BLOCK_SIZE, *( len(lengths) for lengths, _ in sections )
+	))
+
+	for lengths, _ in sections:
+		for length in lengths:
+			index.extend(length.to_bytes(2, "little"))
+
+	alignToMultiple(index, SECTOR_SIZE)
+	index[0:INDEX_STRUCT.size] = INDEX_STRUCT.pack(
+		magic, 3, len(index), vramLength, spuLength, ramLength,
+		*numAtlases, numBuckets, numChained
+	)
+
+	# All blocks are stored back to back so they can be read in one go.
+	output: bytearray = index
+
+	for _, data in sections:
+		output.extend(data)
+
+	alignToMultiple(output, SECTOR_SIZE)
+
+	with args.output as _file:
+		_file.write(output)
+
+	print(f"{len(bundle)} -> {len(output)} bytes")
+
+if __name__ == "__main__":
+	main()
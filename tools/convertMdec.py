@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""PlayStation 1 MDEC image encoder
+
+Compresses an image into the run-length coded macroblock format decoded by the
+PS1's MDEC, for use as a background (add the output to a bundle as a file
+entry and load it with Scene::setBackground()). Each 16x16 macroblock is split
+into two 8x8 chroma blocks and four luma blocks, which are transformed with a
+DCT and quantized using the default MDEC quantization table scaled by the
+given quality factor. Macroblocks are stored in columns, top to bottom, so the
+engine can upload each 16 pixel wide column to VRAM as soon as it's decoded.
+Requires PIL/Pillow and NumPy to be installed.
+"""
+
+__version__ = "0.1.0"
+
+import logging
+from argparse import ArgumentParser, FileType, Namespace
+from struct   import Struct
+
+import numpy
+from numpy import ndarray
+from PIL   import Image
+
+## MDEC bitstream format
+
+HEADER_STRUCT: Struct = Struct("< 4s 2H I")
+HEADER_MAGIC:  bytes  = b"MDEC"
+
+END_OF_BLOCK: int = 0xfe00
+
+# The MDEC's DMA channel transfers 32 words at a time, so the bitstream is
+# padded with end of block codes (which are skipped) to a multiple of that.
+STREAM_ALIGNMENT: int = 64
+
+# Order in which coefficients are stored (index into an 8x8 block in row-major
+# order for each position in the stream).
+ZIGZAG: list[int] = [
+	 0,  1,  8, 16,  9,  2,  3, 10,
+	17, 24, 32, 25, 18, 11,  4,  5,
+	12, 19, 26, 33, 40, 48, 41, 34,
+	27, 20, 13,  6,  7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36,
+	29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46,
+	53, 60, 61, 54, 47, 55, 62, 63
+]
+
+# MPEG-1's default intra quantization table (with 2 instead of 8 for the DC
+# coefficient), in row-major order. Must match the table the engine uploads.
+QUANT_TABLE: list[int] = [
+	 2, 16, 19, 22, 26, 27, 29, 34,
+	16, 16, 22, 24, 27, 29, 34, 37,
+	19, 22, 26, 27, 29, 34, 34, 38,
+	22, 22, 26, 27, 29, 34, 37, 40,
+	22, 26, 27, 29, 32, 35, 40, 48,
+	26, 27, 29, 32, 35, 40, 48, 58,
+	26, 27, 29, 34, 38, 46, 56, 69,
+	27, 29, 35, 38, 46, 56, 69, 83
+]
+
+## Color conversion and DCT
+
+def toYCbCr(image: ndarray) -> tuple[ndarray, ndarray, ndarray]:
+	rgb: ndarray = image.astype(numpy.float64)
+	r, g, b      = rgb[:, :, 0], rgb[:, :, 1], rgb[:, :, 2]
+
+	# The MDEC outputs unsigned pixels by adding 128 to the luma, chroma is
+	# always signed.
+	y:  ndarray = (0.299 * r) + (0.587 * g) + (0.114 * b) - 128.0
+	cb: ndarray = (-0.168736 * r) - (0.331264 * g) + (0.5 * b)
+	cr: ndarray = (0.5 * r) - (0.418688 * g) - (0.081312 * b)
+
+	# Chroma is subsampled by averaging each 2x2 group of pixels.
+	height, width = y.shape
+	cb = cb.reshape(height // 2, 2, width // 2, 2).mean(axis = (1, 3))
+	cr = cr.reshape(height // 2, 2, width // 2, 2).mean(axis = (1, 3))
+
+	return y, cb, cr
+
+def dctMatrix() -> ndarray:
+	matrix: ndarray = numpy.zeros(( 8, 8 ))
+
+	for u in range(8):
+		scale: float = numpy.sqrt(0.125 if not u else 0.25)
+
+		for x in range(8):
+			matrix[u, x] = scale * numpy.cos((2 * x + 1) * u * numpy.pi / 16)
+
+	return matrix
+
+DCT_MATRIX: ndarray = dctMatrix()
+
+def encodeBlock(block: ndarray, scale: int) -> list[int]:
+	coefficients: ndarray = (DCT_MATRIX @ block @ DCT_MATRIX.T).flatten()
+
+	# The DC coefficient is always quantized with the first table entry, the
+	# scale factor is stored alongside it.
+	dc:     int       = int(round(coefficients[0] / QUANT_TABLE[0]))
+	dc                = max(-512, min(511, dc))
+	output: list[int] = [ (scale << 10) | (dc & 0x3ff) ]
+	run:    int       = 0
+
+	for index in ZIGZAG[1:]:
+		step:  float = QUANT_TABLE[index] * scale / 8
+		level: int   = int(round(coefficients[index] / step))
+		level        = max(-512, min(511, level))
+
+		if not level:
+			run += 1
+			continue
+
+		output.append((run << 10) | (level & 0x3ff))
+		run = 0
+
+	output.append(END_OF_BLOCK)
+	return output
+
+def encodeImage(image: ndarray, scale: int) -> bytearray:
+	y, cb, cr     = toYCbCr(image)
+	height, width = y.shape
+	codes         = []
+
+	for x in range(0, width, 16):
+		for _y in range(0, height, 16):
+			cx: int = x  // 2
+			cy: int = _y // 2
+
+			codes.extend(encodeBlock(cr[cy:cy + 8, cx:cx + 8], scale))
+			codes.extend(encodeBlock(cb[cy:cy + 8, cx:cx + 8], scale))
+			codes.extend(encodeBlock(y[_y:_y + 8,      x:x + 8],      scale))
+			codes.extend(encodeBlock(y[_y:_y + 8,      x + 8:x + 16], scale))
+			codes.extend(encodeBlock(y[_y + 8:_y + 16, x:x + 8],      scale))
+			codes.extend(encodeBlock(y[_y + 8:_y + 16, x + 8:x + 16], scale))
+
+	while len(codes) % STREAM_ALIGNMENT:
+		codes.append(END_OF_BLOCK)
+
+	return bytearray(numpy.array(codes, "<H").tobytes())
+
+## Main
+
+def createParser() -> ArgumentParser:
+	parser = ArgumentParser(
+		description = \
+			"Compresses an image into MDEC macroblocks for use as a "
+			"background.",
+		add_help    = False
+	)
+
+	group = parser.add_argument_group("Tool options")
+	group.add_argument(
+		"-h", "--help",
+		action = "help",
+		help   = "Show this help message and exit"
+	)
+
+	group = parser.add_argument_group("Encoding options")
+	group.add_argument(
+		"-q", "--quantize",
+		type    = int,
+		default = 4,
+		help    = \
+			"Quantization scale from 1 (best quality, largest file) to 63 "
+			"(default 4)",
+		metavar = "scale"
+	)
+
+	group = parser.add_argument_group("File paths")
+	group.add_argument(
+		"input",
+		type = Image.open,
+		help = "Path to input image file"
+	)
+	group.add_argument(
+		"output",
+		type = FileType("wb"),
+		help = "Path to MDEC data file to generate"
+	)
+
+	return parser
+
+def main():
+	parser: ArgumentParser = createParser()
+	args:   Namespace      = parser.parse_args()
+
+	logging.basicConfig(
+		format = "{levelname}: {message}",
+		style  = "{",
+		level  = logging.INFO
+	)
+
+	if not 1 <= args.quantize <= 63:
+		parser.error("quantization scale must be in 1-63 range")
+
+	with args.input as _image:
+		image: ndarray = numpy.asarray(_image.convert("RGB"))
+
+	height, width = image.shape[0:2]
+
+	if (width % 16) or (height % 16):
+		parser.error(f"image size must be a multiple of 16 pixels (got {width}x{height})")
+	if (width > 1024) or (height > 512):
+		parser.error(f"image doesn't fit in VRAM (got {width}x{height})")
+
+	data: bytearray = encodeImage(image, args.quantize)
+
+	with args.output as _file:
+		_file.write(HEADER_STRUCT.pack(HEADER_MAGIC, width, height, len(data) // 4))
+		_file.write(data)
+
+	logging.info(f"{width * height * 2} -> {HEADER_STRUCT.size + len(data)} bytes")
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,470 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""PlayStation 1 MIDI sequence converter
+
+Converts a standard MIDI file (format 0 or 1) into the sequence format played
+by the Sequencer class. Tempo changes are baked in, so the output only has to
+count ticks at a fixed rate, and MIDI programs are mapped to sounds from a
+bundle, which are played at the note's pitch relative to the instrument's base
+note. Note on/off, program change, volume (CC 7), pan (CC 10) and pitch bend
+events are kept, everything else is dropped. A "loopStart" marker sets where
+looping songs jump back to and a "loopEnd" marker where they end. Add the
+output to a bundle JSON as a file, along with the sounds it uses.
+"""
+
+__version__ = "0.1.0"
+
+import logging
+from argparse import ArgumentParser, FileType, Namespace
+from dataclasses import dataclass
+from struct   import Struct
+
+from checkAssetNames import fdgHash
+
+## Sequence format
+
+HEADER_STRUCT:     Struct = Struct("< 4s H 2B 2I")
+INSTRUMENT_STRUCT: Struct = Struct("< I 2B 3H")
+HEADER_MAGIC:      bytes  = b"PSEQ"
+
+NO_LOOP:  int = 0xffffffff
+CHANNELS: int = 16
+
+EVENT_NOTE_OFF:   int = 0x8
+EVENT_NOTE_ON:    int = 0x9
+EVENT_PAN:        int = 0xa
+EVENT_VOLUME:     int = 0xb
+EVENT_INSTRUMENT: int = 0xc
+EVENT_BEND:       int = 0xe
+EVENT_END:        int = 0xff
+
+NO_INSTRUMENT: int = 0xff
+SEMITONE:      int = 256 # Pitch bends are stored in 1/256 semitones
+
+# Events on the same tick are sorted so that channel settings apply before the
+# notes and notes are released before new ones start.
+EVENT_ORDER: dict[int, int] = {
+	EVENT_INSTRUMENT: 0,
+	EVENT_VOLUME:     0,
+	EVENT_PAN:        0,
+	EVENT_BEND:       0,
+	EVENT_NOTE_OFF:   1,
+	EVENT_NOTE_ON:    2
+}
+
+def encodeNumber(value: int) -> bytes:
+	data: bytearray = bytearray([ value & 0x7f ])
+	value >>= 7
+
+	while value:
+		data.insert(0, 0x80 | (value & 0x7f))
+		value >>= 7
+
+	return bytes(data)
+
+@dataclass
+class Instrument:
+	sound:    str
+	baseNote: int = 60
+	volume:   int = 127
+	adsr1:    int = 0x00ff
+	adsr2:    int = 0x0000
+
+def parseInstrument(value: str) -> tuple[int, Instrument]:
+	program, _, mapping = value.partition("=")
+	fields: list[str] = mapping.split(":")
+
+	if not fields[0] or (len(fields) > 5):
+		raise ValueError(f"invalid instrument: {value}")
+
+	return int(program, 0), Instrument(
+		fields[0], *( int(field, 0) for field in fields[1:] )
+	)
+
+## MIDI parsing
+
+@dataclass
+class MIDIEvent:
+	tick:   int
+	status: int
+	data:   bytes
+
+class MIDIFile:
+	def __init__(self, data: bytes):
+		if data[0:4] != b"MThd":
+			raise ValueError("not a MIDI file")
+
+		headerLength: int = int.from_bytes(data[4:8], "big")
+		midiFormat:   int = int.from_bytes(data[8:10], "big")
+		numTracks:    int = int.from_bytes(data[10:12], "big")
+		division:     int = int.from_bytes(data[12:14], "big")
+
+		if midiFormat > 1:
+			raise ValueError(f"MIDI format {midiFormat} is not supported")
+		if division & 0x8000:
+			raise ValueError("SMPTE timing is not supported")
+
+		self.ticksPerBeat: int             = division
+		self.events:       list[MIDIEvent] = []
+		self.length:       int             = 0
+
+		offset: int = 8 + headerLength
+
+		for _ in range(numTracks):
+			chunkType:   bytes = data[offset:offset + 4]
+			chunkLength: int   = int.from_bytes(data[offset + 4:offset + 8], "big")
+			offset            += 8
+
+			if chunkType == b"MTrk":
+				self._parseTrack(data[offset:offset + chunkLength])
+
+			offset += chunkLength
+
+		# Python's sort is stable, so events on the same tick stay in the order
+		# they were in their track.
+		self.events.sort(key = lambda event: event.tick)
+
+	def _parseTrack(self, data: bytes):
+		offset:        int = 0
+		tick:          int = 0
+		runningStatus: int = 0
+
+		def readNumber() -> int:
+			nonlocal offset
+			value: int = 0
+
+			while True:
+				byte: int = data[offset]
+				offset   += 1
+				value     = (value << 7) | (byte & 0x7f)
+
+				if not (byte & 0x80):
+					return value
+
+		while offset < len(data):
+			tick += readNumber()
+
+			if data[offset] & 0x80:
+				status: int = data[offset]
+				offset     += 1
+			else:
+				status: int = runningStatus
+
+			if status == 0xff:
+				metaType: int = data[offset]
+				offset       += 1
+				length:   int = readNumber()
+
+				self.events.append(MIDIEvent(
+					tick, metaType << 8 | 0xff, data[offset:offset + length]
+				))
+				offset += length
+
+				if metaType == 0x2f:
+					break
+			elif status in ( 0xf0, 0xf7 ):
+				offset += readNumber()
+			else:
+				length: int = 1 if (status >> 4) in ( 0xc, 0xd ) else 2
+				runningStatus = status
+
+				self.events.append(MIDIEvent(
+					tick, status, data[offset:offset + length]
+				))
+				offset += length
+
+		self.length = max(self.length, tick)
+
+	def toSeconds(self) -> dict[int, float]:
+		# Tempo changes apply to all tracks, so the time of each tick only
+		# depends on the tempo events before it.
+		times:    dict[int, float] = {}
+		tempo:    int              = 500000 # Microseconds per beat
+		lastTick: int              = 0
+		time:     float            = 0.0
+
+		ticks: list[int] = sorted(
+			set(event.tick for event in self.events) | { self.length }
+		)
+		tempoChanges: list[MIDIEvent] = [
+			event for event in self.events if event.status == 0x51ff
+		]
+
+		for tick in ticks:
+			while tempoChanges and tempoChanges[0].tick <= tick:
+				change: MIDIEvent = tempoChanges.pop(0)
+				time     += (change.tick - lastTick) * tempo / (self.ticksPerBeat * 1e6)
+				lastTick  = change.tick
+				tempo     = int.from_bytes(change.data, "big")
+
+			times[tick] = time + (tick - lastTick) * tempo / (self.ticksPerBeat * 1e6)
+
+		return times
+
+## Conversion
+
+def convertEvents(
+	midi:        MIDIFile,
+	programs:    dict[int, int],
+	rate:        int,
+	bendRange:   int
+) -> tuple[list[tuple[int, int, bytes]], int, int]:
+	times: dict[int, float] = midi.toSeconds()
+	toTick = lambda tick: round(times[tick] * rate)
+
+	events:    list[tuple[int, int, bytes]] = []
+	loopStart: int                          = 0
+	endTick:   int                          = toTick(midi.length)
+	unmapped:  set[int]                     = set()
+
+	for event in midi.events:
+		tick:    int   = toTick(event.tick)
+		kind:    int   = event.status >> 4
+		channel: int   = event.status & 0xf
+		data:    bytes = event.data
+
+		if event.status == 0x06ff:
+			marker: str = data.decode("ascii", "replace").strip()
+
+			if marker == "loopStart":
+				loopStart = tick
+			elif marker == "loopEnd":
+				endTick = tick
+		elif (event.status & 0xff) == 0xff:
+			continue
+		elif (kind == 0x9) and data[1]:
+			events.append(( tick, event.status, data ))
+		elif kind in ( 0x8, 0x9 ):
+			events.append(( tick, EVENT_NOTE_OFF << 4 | channel, data[0:1] ))
+		elif kind == 0xc:
+			if data[0] not in programs:
+				unmapped.add(data[0])
+
+			events.append((
+				tick, event.status,
+				bytes([ programs.get(data[0], NO_INSTRUMENT) ])
+			))
+		elif (kind == 0xb) and (data[0] == 7):
+			events.append(( tick, EVENT_VOLUME << 4 | channel, data[1:2] ))
+		elif (kind == 0xb) and (data[0] == 10):
+			events.append(( tick, EVENT_PAN << 4 | channel, data[1:2] ))
+		elif kind == 0xe:
+			bend: int = ((data[0] | data[1] << 7) - 0x2000) * bendRange * SEMITONE // 0x2000
+			events.append(( tick, event.status, bend.to_bytes(2, "little", signed = True) ))
+
+	for program in sorted(unmapped):
+		logging.warning(f"program {program} has no instrument, its notes will be skipped")
+
+	# Channels that never change programs use program 0, like on a MIDI synth.
+	channelsWithPrograms: set[int] = set(
+		status & 0xf for _, status, _ in events if (status >> 4) == EVENT_INSTRUMENT
+	)
+	channelsWithNotes: set[int] = set(
+		status & 0xf for _, status, _ in events if (status >> 4) == EVENT_NOTE_ON
+	)
+	for channel in sorted(channelsWithNotes - channelsWithPrograms):
+			events.append((
+				0, EVENT_INSTRUMENT << 4 | channel,
+				bytes([ programs.get(0, NO_INSTRUMENT) ])
+			))
+
+	events = [ event for event in events if event[0] < endTick ]
+	events.sort(key = lambda event: ( event[0], EVENT_ORDER[event[1] >> 4] ))
+
+	return events, loopStart, max(endTick, 1)
+
+def encodeSequence(
+	events:    list[tuple[int, int, bytes]],
+	loopStart: int | None,
+	endTick:   int
+) -> tuple[bytearray, int]:
+	data:       bytearray     = bytearray()
+	loopOffset: int           = NO_LOOP
+	lastTick:   int           = 0
+	held:       set[int]      = set() # Channel << 8 | note
+
+	# Channels keep their settings when jumping back, so the settings they had
+	# at the loop point are set again right after it.
+	channels:  list[dict[int, bytes]] = [ {} for _ in range(CHANNELS) ]
+	loopState: list[tuple[int, bytes]] = []
+
+	def addEvent(tick: int, status: int, params: bytes):
+		nonlocal lastTick
+
+		data.extend(encodeNumber(tick - lastTick))
+		data.append(status)
+		data.extend(params)
+		lastTick = tick
+
+	for index in range(len(events) + 1):
+		tick: int = events[index][0] if index < len(events) else endTick
+
+		if (loopStart is not None) and (loopOffset == NO_LOOP) and (tick >= loopStart):
+			loopState = [
+				( kind << 4 | channel, params )
+				for channel, settings in enumerate(channels)
+				for kind, params in settings.items()
+			] or [ ( EVENT_VOLUME << 4, b"\x7f" ) ]
+
+			# The sequencer reads the time until the next event right after
+			# jumping, so it has to land after an event on the loop's tick.
+			addEvent(loopStart, *loopState[0])
+			loopOffset = len(data)
+
+			for status, params in loopState:
+				addEvent(loopStart, status, params)
+
+		if index == len(events):
+			break
+
+		_, status, params = events[index]
+		kind:    int = status >> 4
+		channel: int = status & 0xf
+
+		if kind == EVENT_NOTE_ON:
+			held.add(channel << 8 | params[0])
+		elif kind == EVENT_NOTE_OFF:
+			held.discard(channel << 8 | params[0])
+		else:
+			channels[channel][kind] = params
+
+		addEvent(tick, status, params)
+
+	# Notes still playing at the end would otherwise keep playing after
+	# jumping back.
+	for note in sorted(held):
+		addEvent(endTick, EVENT_NOTE_OFF << 4 | note >> 8, bytes([ note & 0xff ]))
+
+	addEvent(endTick, EVENT_END, b"")
+
+	return data, loopOffset
+
+## Main
+
+def createParser() -> ArgumentParser:
+	parser = ArgumentParser(
+		description = \
+			"Converts a MIDI file into a sequence for the Sequencer class.",
+		add_help    = False
+	)
+
+	group = parser.add_argument_group("Tool options")
+	group.add_argument(
+		"-h", "--help",
+		action = "help",
+		help   = "Show this help message and exit"
+	)
+
+	group = parser.add_argument_group("Sequence options")
+	group.add_argument(
+		"-i", "--instrument",
+		action  = "append",
+		type    = parseInstrument,
+		default = [],
+		help    = \
+			"Map a MIDI program to a sound, as PROGRAM=sound[:baseNote"
+			"[:volume[:adsr1:adsr2]]] (can be given more than once, base note "
+			"defaults to 60)",
+		metavar = "mapping"
+	)
+	group.add_argument(
+		"-r", "--rate",
+		type    = int,
+		default = 120,
+		help    = \
+			"Set ticks per second, must not be above SCHEDULER_RATE (default "
+			"120)",
+		metavar = "rate"
+	)
+	group.add_argument(
+		"-b", "--bend-range",
+		type    = int,
+		default = 2,
+		help    = "Set the pitch bend range in semitones (default 2)",
+		metavar = "semitones"
+	)
+	group.add_argument(
+		"-l", "--loop",
+		action = "store_true",
+		help   = \
+			"Loop the song, from its loopStart marker if there is one or "
+			"from the beginning otherwise"
+	)
+
+	group = parser.add_argument_group("File paths")
+	group.add_argument(
+		"input",
+		type = FileType("rb"),
+		help = "Path to MIDI file to convert"
+	)
+	group.add_argument(
+		"output",
+		type = FileType("wb"),
+		help = "Path to sequence file to generate"
+	)
+
+	return parser
+
+def main():
+	parser: ArgumentParser = createParser()
+	args:   Namespace      = parser.parse_args()
+
+	logging.basicConfig(
+		format = "{levelname}: {message}",
+		style  = "{",
+		level  = logging.INFO
+	)
+
+	if not args.instrument:
+		parser.error("at least one instrument must be given")
+	if len(args.instrument) >= NO_INSTRUMENT:
+		parser.error(f"too many instruments ({len(args.instrument)})")
+	if not (1 <= args.rate <= 0xffff):
+		parser.error(f"invalid tick rate ({args.rate})")
+
+	programs:    dict[int, int]   = {}
+	instruments: list[Instrument] = []
+
+	for program, instrument in args.instrument:
+		programs[program] = len(instruments)
+		instruments.append(instrument)
+
+	with args.input as _file:
+		try:
+			midi: MIDIFile = MIDIFile(_file.read())
+		except (ValueError, IndexError) as err:
+			parser.error(f"can't read MIDI file: {err}")
+
+	events, loopStart, endTick = convertEvents(
+		midi, programs, args.rate, args.bend_range
+	)
+	data, loopOffset           = encodeSequence(
+		events, loopStart if args.loop else None, endTick
+	)
+
+	eventsOffset: int = \
+		HEADER_STRUCT.size + INSTRUMENT_STRUCT.size * len(instruments)
+
+	with args.output as _file:
+		_file.write(HEADER_STRUCT.pack(
+			HEADER_MAGIC, args.rate, len(instruments), 0,
+			loopOffset if loopOffset == NO_LOOP else eventsOffset + loopOffset,
+			eventsOffset
+		))
+
+		for instrument in instruments:
+			_file.write(INSTRUMENT_STRUCT.pack(
+				fdgHash(instrument.sound), instrument.baseNote,
+				instrument.volume, instrument.adsr1, instrument.adsr2, 0
+			))
+
+		_file.write(data)
+
+	logging.info(
+		f"{endTick / args.rate:.1f} seconds, {len(data)} bytes of events, "
+		f"{len(instruments)} instruments"
+	)
+
+if __name__ == "__main__":
+	main()
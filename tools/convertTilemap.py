@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""PlayStation 1 tile map converter
+
+Converts a tile map (as a CSV file of tile numbers, e.g. exported from Tiled,
+where 0 is an empty tile and 1 is the first tile of the tileset) and its
+tileset image into the format streamed by the TileMap component. The map is
+split into 32x32 tile chunks of one sector each, so the engine only has to keep
+the ones around the camera in RAM, and the 16x16 tiles are stored as 15bpp
+pixels so they can be uploaded to VRAM as they're needed. Add the output to a
+bundle JSON as a file and make sure that bundle isn't compressed. Requires
+PIL/Pillow and NumPy to be installed.
+"""
+
+__version__ = "0.1.0"
+
+import logging
+from argparse import ArgumentParser, FileType, Namespace
+from struct   import Struct
+
+import numpy
+from numpy import ndarray
+from PIL   import Image
+
+## Tile map format
+
+HEADER_STRUCT: Struct = Struct("< 4s 6H I")
+HEADER_MAGIC:  bytes  = b"TMAP"
+
+SECTOR_SIZE: int = 2048
+TILE_SIZE:   int = 16
+CHUNK_TILES: int = 32
+
+# Tiled stores flipping and rotation in the top bits of each tile number.
+TILED_FLAG_MASK: int = 0xf0000000
+
+def padToSector(data: bytes) -> bytes:
+	return data + bytes(-len(data) % SECTOR_SIZE)
+
+## Conversion
+
+def readMap(file) -> ndarray:
+	rows: list[list[int]] = []
+
+	for line in file:
+		line = line.strip()
+
+		if line:
+			rows.append([
+				int(value) & ~TILED_FLAG_MASK
+				for value in line.rstrip(",").split(",")
+			])
+
+	if any(len(row) != len(rows[0]) for row in rows):
+		raise ValueError("all rows of the map must be the same length")
+
+	return numpy.array(rows, numpy.uint32)
+
+def convertTiles(image: ndarray) -> list[bytes]:
+	rgba: ndarray = image.astype(numpy.uint16)
+
+	# Fully black pixels get the semi-transparency bit set so the GPU doesn't
+	# treat them as transparent.
+	pixels: ndarray = (rgba[:, :, 0] >> 3) | ((rgba[:, :, 1] >> 3) << 5) | ((rgba[:, :, 2] >> 3) << 10)
+	pixels[pixels == 0] = 0x8000
+	pixels[rgba[:, :, 3] < 128] = 0
+
+	height, width = pixels.shape
+	tiles: list[bytes] = []
+
+	for y in range(0, height - TILE_SIZE + 1, TILE_SIZE):
+		for x in range(0, width - TILE_SIZE + 1, TILE_SIZE):
+			tile: ndarray = pixels[y:y + TILE_SIZE, x:x + TILE_SIZE]
+			tiles.append(tile.astype("<u2").tobytes())
+
+	return tiles
+
+def convertChunks(tileMap: ndarray) -> tuple[int, int, bytearray]:
+	height, width = tileMap.shape
+	chunksWide: int = (width  + CHUNK_TILES - 1) // CHUNK_TILES
+	chunksHigh: int = (height + CHUNK_TILES - 1) // CHUNK_TILES
+
+	# Tiles past the edge of the map are left empty.
+	padded: ndarray = numpy.zeros(
+		( chunksHigh * CHUNK_TILES, chunksWide * CHUNK_TILES ), "<u2"
+	)
+	padded[0:height, 0:width] = tileMap
+
+	data: bytearray = bytearray()
+
+	for y in range(chunksHigh):
+		for x in range(chunksWide):
+			chunk: ndarray = padded[
+				y * CHUNK_TILES:(y + 1) * CHUNK_TILES,
+				x * CHUNK_TILES:(x + 1) * CHUNK_TILES
+			]
+			data.extend(chunk.tobytes())
+
+	return chunksWide, chunksHigh, data
+
+## Main
+
+def createParser() -> ArgumentParser:
+	parser = ArgumentParser(
+		description = \
+			"Converts a tile map and its tileset into a streamable map for "
+			"the TileMap component.",
+		add_help    = False
+	)
+
+	group = parser.add_argument_group("Tool options")
+	group.add_argument(
+		"-h", "--help",
+		action = "help",
+		help   = "Show this help message and exit"
+	)
+
+	group = parser.add_argument_group("File paths")
+	group.add_argument(
+		"map",
+		type = FileType("rt"),
+		help = "Path to CSV file with the map's tile numbers (0 for empty tiles)"
+	)
+	group.add_argument(
+		"tileset",
+		type = Image.open,
+		help = "Path to tileset image made of 16x16 tiles, numbered in rows starting from 1"
+	)
+	group.add_argument(
+		"output",
+		type = FileType("wb"),
+		help = "Path to tile map file to generate"
+	)
+
+	return parser
+
+def main():
+	parser: ArgumentParser = createParser()
+	args:   Namespace      = parser.parse_args()
+
+	logging.basicConfig(
+		format = "{levelname}: {message}",
+		style  = "{",
+		level  = logging.INFO
+	)
+
+	with args.map as _file:
+		try:
+			tileMap: ndarray = readMap(_file)
+		except ValueError as err:
+			parser.error(str(err))
+
+	with args.tileset as _image:
+		tiles: list[bytes] = convertTiles(numpy.asarray(_image.convert("RGBA")))
+
+	height, width = tileMap.shape
+
+	if (width > 0xffff) or (height > 0xffff):
+		parser.error(f"map is too large (got {width}x{height} tiles)")
+	if len(tiles) >= 0xffff:
+		parser.error(f"tileset has too many tiles ({len(tiles)})")
+	if tileMap.max(initial = 0) > len(tiles):
+		parser.error(f"map uses tile {tileMap.max()} but the tileset only has {len(tiles)}")
+
+	chunksWide, chunksHigh, chunks = convertChunks(tileMap)
+	tilesOffset: int = SECTOR_SIZE + len(chunks)
+
+	header: bytes = HEADER_STRUCT.pack(
+		HEADER_MAGIC, width, height, chunksWide, chunksHigh, len(tiles), 0,
+		tilesOffset
+	)
+
+	with args.output as _file:
+		_file.write(padToSector(header))
+		_file.write(chunks)
+		_file.write(padToSector(b"".join(tiles)))
+
+	logging.info(
+		f"{width}x{height} tiles in {chunksWide * chunksHigh} chunks, "
+		f"{len(tiles)} tiles in tileset"
+	)
+
+if __name__ == "__main__":
+	main()
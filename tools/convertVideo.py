@@ -0,0 +1,317 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""PlayStation 1 video encoder
+
+Compresses a sequence of images into a stream of Mode 2 Form 2 sectors that
+can be played back with the VideoPlayer scene, optionally interleaved with an
+XA-ADPCM audio track (e.g. one converted with psxavenc, in 2336-byte sectors).
+Each frame is compressed into MDEC macroblocks like convertMdec.py does, with
+the quantization scale picked per frame so it fits in the sectors the drive
+reads in one frame period. Frames are padded to exactly that many sectors so
+the drive never has to pause while audio is playing. The output is meant to be
+added to the disc image by mkpsxiso as a file with type="str". Requires
+PIL/Pillow and NumPy to be installed.
+"""
+
+__version__ = "0.1.0"
+
+import logging
+from argparse import ArgumentParser, FileType, Namespace
+from collections import deque
+from struct   import Struct
+
+import numpy
+from numpy import ndarray
+from PIL   import Image
+
+from convertMdec import encodeImage
+
+## Sector format
+
+PAYLOAD_SIZE: int = 2324
+EDC_SIZE:     int = 4
+SECTOR_SIZE:  int = 8 + PAYLOAD_SIZE + EDC_SIZE
+
+SUBHEADER_STRUCT: Struct = Struct("< 4B")
+
+SUBMODE_EOR:   int = 1 << 0
+SUBMODE_DATA:  int = 1 << 3
+SUBMODE_FORM2: int = 1 << 5
+SUBMODE_EOF:   int = 1 << 7
+
+# Audio is played from file 1, channel 0. Video sectors get the same numbers
+# so the whole stream looks like a single file.
+FILE_NUMBER: int = 1
+CHANNEL:     int = 0
+
+# Every video sector starts with this header, followed by CHUNK_SIZE bytes of
+# the frame's bitstream. Sectors with a magic of 0 are padding.
+FRAME_HEADER_STRUCT: Struct = Struct("< H 2B 2H 2I 2H")
+FRAME_MAGIC:         int    = 0x0160
+FRAME_VERSION:       int    = 0
+
+CHUNK_SIZE: int = PAYLOAD_SIZE - FRAME_HEADER_STRUCT.size
+
+SECTORS_PER_SECOND: int = 75
+
+def packSector(payload: bytes, submode: int) -> bytes:
+	# The subheader is stored twice. The EDC is left blank, which tells the
+	# drive not to check it.
+	subheader: bytes = SUBHEADER_STRUCT.pack(FILE_NUMBER, CHANNEL, submode, 0)
+
+	return subheader + subheader + payload + bytes(EDC_SIZE)
+
+def packFrame(
+	data: bytes, frame: int, fps: int, width: int, height: int
+) -> list[bytes]:
+	numChunks: int         = (len(data) + CHUNK_SIZE - 1) // CHUNK_SIZE
+	chunks:    list[bytes] = []
+
+	for chunk in range(numChunks):
+		header: bytes = FRAME_HEADER_STRUCT.pack(
+			FRAME_MAGIC, fps, FRAME_VERSION, chunk, numChunks, frame,
+			len(data) // 4, width, height
+		)
+		body:   bytes = data[chunk * CHUNK_SIZE:(chunk + 1) * CHUNK_SIZE]
+
+		chunks.append(header + body + bytes(CHUNK_SIZE - len(body)))
+
+	return chunks
+
+## Rate control
+
+def encodeFrame(image: ndarray, budget: int, maxScale: int) -> bytes:
+	# Larger scales give smaller output, so the smallest scale that fits the
+	# budget is found with a binary search.
+	low:  int   = 1
+	high: int   = maxScale
+	best: bytes = encodeImage(image, maxScale)
+
+	while low < high:
+		scale: int   = (low + high) // 2
+		data:  bytes = encodeImage(image, scale)
+
+		if len(data) <= budget:
+			best = data
+			high = scale
+		else:
+			low  = scale + 1
+
+	return best
+
+## Interleaving
+
+def interleave(
+	frames:     list[list[bytes]],
+	audio:      list[bytes],
+	framePeriod: int,
+	audioPeriod: int
+) -> list[bytes]:
+	sectors: list[bytes]  = []
+	pending: deque[bytes] = deque()
+	queue:   deque[bytes] = deque(audio)
+	overrun: int          = 0
+
+	padding: bytes = packSector(bytes(PAYLOAD_SIZE), SUBMODE_DATA | SUBMODE_FORM2)
+
+	index: int = 0
+
+	while (index // framePeriod) < len(frames) or pending or queue:
+		# Each frame's sectors become available at the start of its period,
+		# so if one overruns its budget the following ones are delayed.
+		if not (index % framePeriod) and (index // framePeriod) < len(frames):
+			if pending:
+				overrun += 1
+
+			pending.extend(frames[index // framePeriod])
+
+		if audioPeriod and not (index % audioPeriod):
+			if queue:
+				sector: bytearray = bytearray(queue.popleft())
+
+				# Make the audio match the filter set by the player.
+				sector[0] = sector[4] = FILE_NUMBER
+				sector[1] = sector[5] = CHANNEL
+				sectors.append(bytes(sector))
+			else:
+				sectors.append(padding)
+		elif pending:
+			sectors.append(packSector(pending.popleft(), SUBMODE_DATA | SUBMODE_FORM2))
+		else:
+			sectors.append(padding)
+
+		index += 1
+
+	if overrun:
+		logging.warning(f"{overrun} frames didn't fit their budget, playback may skip frames")
+
+	# Mark the end of the file so the player stops reading there.
+	last: bytearray = bytearray(sectors[-1])
+	last[2] |= SUBMODE_EOR | SUBMODE_EOF
+	last[6] |= SUBMODE_EOR | SUBMODE_EOF
+	sectors[-1] = bytes(last)
+
+	return sectors
+
+## Main
+
+def createParser() -> ArgumentParser:
+	parser = ArgumentParser(
+		description = \
+			"Compresses a sequence of images and an optional XA audio track "
+			"into a video for the VideoPlayer scene.",
+		add_help    = False
+	)
+
+	group = parser.add_argument_group("Tool options")
+	group.add_argument(
+		"-h", "--help",
+		action = "help",
+		help   = "Show this help message and exit"
+	)
+
+	group = parser.add_argument_group("Encoding options")
+	group.add_argument(
+		"-r", "--fps",
+		type    = int,
+		default = 15,
+		help    = "Frame rate, which must divide the sector rate evenly (default 15)",
+		metavar = "fps"
+	)
+	group.add_argument(
+		"-s", "--size",
+		type    = int,
+		nargs   = 2,
+		default = ( 320, 240 ),
+		help    = \
+			"Size to scale frames to, should match the screen size (default "
+			"320 240)",
+		metavar = ( "width", "height" )
+	)
+	group.add_argument(
+		"-q", "--max-quantize",
+		type    = int,
+		default = 63,
+		help    = \
+			"Highest quantization scale to use when a frame doesn't fit, from "
+			"1 to 63 (default 63)",
+		metavar = "scale"
+	)
+	group.add_argument(
+		"-S", "--speed",
+		type    = int,
+		choices = ( 1, 2 ),
+		default = 2,
+		help    = "CD-ROM speed the video is played at (default 2)"
+	)
+
+	group = parser.add_argument_group("Audio options")
+	group.add_argument(
+		"-a", "--xa",
+		type    = FileType("rb"),
+		help    = \
+			"Path to XA-ADPCM audio in 2336-byte sectors to interleave with "
+			"the video",
+		metavar = "path"
+	)
+	group.add_argument(
+		"-i", "--interleave",
+		type    = int,
+		default = 8,
+		help    = \
+			"Place an audio sector every this many sectors, which depends on "
+			"the audio's sample rate, channels and the CD-ROM speed (default "
+			"8, for 37800 Hz stereo at 2x)",
+		metavar = "sectors"
+	)
+
+	group = parser.add_argument_group("File paths")
+	group.add_argument(
+		"input",
+		type  = str,
+		nargs = "+",
+		help  = "Paths to input image files, in playback order"
+	)
+	group.add_argument(
+		"output",
+		type = FileType("wb"),
+		help = "Path to video file to generate"
+	)
+
+	return parser
+
+def main():
+	parser: ArgumentParser = createParser()
+	args:   Namespace      = parser.parse_args()
+
+	logging.basicConfig(
+		format = "{levelname}: {message}",
+		style  = "{",
+		level  = logging.INFO
+	)
+
+	width, height = args.size
+	sectorRate: int = SECTORS_PER_SECOND * args.speed
+
+	if (width % 16) or (height % 16):
+		parser.error(f"frame size must be a multiple of 16 pixels (got {width}x{height})")
+	if (width > 640) or (height > 256):
+		parser.error(f"frames don't fit in VRAM (got {width}x{height})")
+	if not 1 <= args.max_quantize <= 63:
+		parser.error("quantization scale must be in 1-63 range")
+	if (args.fps < 1) or (sectorRate % args.fps):
+		parser.error(f"frame rate must divide {sectorRate} sectors per second")
+	if args.interleave < 2:
+		parser.error("interleave must be at least 2")
+
+	framePeriod: int = sectorRate // args.fps
+	audioPeriod: int = args.interleave if args.xa else 0
+	audio: list[bytes] = []
+
+	if args.xa:
+		with args.xa as _file:
+			data: bytes = _file.read()
+
+		if len(data) % SECTOR_SIZE:
+			parser.error(f"XA file size must be a multiple of {SECTOR_SIZE} bytes")
+
+		audio = [
+			data[offset:offset + SECTOR_SIZE]
+			for offset in range(0, len(data), SECTOR_SIZE)
+		]
+
+	# Audio sectors land in every frame period at different offsets, so the
+	# budget is based on the period with the fewest video sectors.
+	budget: int = framePeriod
+
+	if audioPeriod:
+		budget -= (framePeriod + audioPeriod - 1) // audioPeriod
+
+	if budget < 1:
+		parser.error("no room left for video with this frame rate and interleave")
+
+	frames: list[list[bytes]] = []
+
+	for index, path in enumerate(args.input):
+		with Image.open(path) as _image:
+			image: ndarray = numpy.asarray(
+				_image.convert("RGB").resize(( width, height ), Image.LANCZOS)
+			)
+
+		data: bytes = encodeFrame(image, budget * CHUNK_SIZE, args.max_quantize)
+		frames.append(packFrame(data, index, args.fps, width, height))
+
+	sectors: list[bytes] = interleave(frames, audio, framePeriod, audioPeriod)
+
+	with args.output as _file:
+		for sector in sectors:
+			_file.write(sector)
+
+	logging.info(
+		f"{len(frames)} frames, {len(audio)} audio sectors -> "
+		f"{len(sectors)} sectors ({len(sectors) / sectorRate:.1f} seconds)"
+	)
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+"""Mode 2 Form 2 file packer
+
+Splits a file into 2324-byte chunks and wraps each one in an XA subheader
+marking it as a Form 2 data sector, producing the 2336-byte sectors mkpsxiso
+expects for files with type="str". Form 2 sectors carry no ECC, so the same
+data takes about 13% fewer sectors (and less time to read) than a regular file.
+Read these files with CdRead(..., CdlModeForm2) or the CdStream API.
+"""
+
+__version__ = "0.1.0"
+
+from argparse import ArgumentParser, FileType, Namespace
+from struct   import Struct
+
+## Sector format
+
+PAYLOAD_SIZE: int = 2324
+EDC_SIZE:     int = 4
+
+SUBHEADER_STRUCT: Struct = Struct("< 4B")
+
+SUBMODE_EOR:   int = 1 << 0
+SUBMODE_DATA:  int = 1 << 3
+SUBMODE_FORM2: int = 1 << 5
+SUBMODE_EOF:   int = 1 << 7
+
+def packSectors(data: bytes, fileNumber: int, channel: int) -> bytearray:
+	output: bytearray = bytearray()
+	offset: int       = 0
+
+	while True:
+		chunk:   bytes = data[offset:offset + PAYLOAD_SIZE]
+		offset        += PAYLOAD_SIZE
+		submode: int   = SUBMODE_DATA | SUBMODE_FORM2
+
+		if offset >= len(data):
+			submode |= SUBMODE_EOR | SUBMODE_EOF
+
+		# The subheader is stored twice. The EDC is left blank, which tells
+		# the drive not to check it.
+		subheader: bytes = SUBHEADER_STRUCT.pack(fileNumber, channel, submode, 0)
+
+		output.extend(subheader)
+		output.extend(subheader)
+		output.extend(chunk)
+		output.extend(b"\0" * (PAYLOAD_SIZE - len(chunk) + EDC_SIZE))
+
+		if offset >= len(data):
+			return output
+
+## Main
+
+def createParser() -> ArgumentParser:
+	parser = ArgumentParser(
+		description = \
+			"Packs a file into Mode 2 Form 2 sectors for use with mkpsxiso's "
+			"\"str\" file type.",
+		add_help    = False
+	)
+
+	group = parser.add_argument_group("Tool options")
+	group.add_argument(
+		"-h", "--help",
+		action = "help",
+		help   = "Show this help message and exit"
+	)
+
+	group = parser.add_argument_group("Subheader options")
+	group.add_argument(
+		"-f", "--file",
+		type    = int,
+		default = 1,
+		help    = "XA file number to store in each sector (default 1)",
+		metavar = "number"
+	)
+	group.add_argument(
+		"-c", "--channel",
+		type    = int,
+		default = 0,
+		help    = "XA channel number to store in each sector (default 0)",
+		metavar = "number"
+	)
+
+	group = parser.add_argument_group("File paths")
+	group.add_argument(
+		"input",
+		type = FileType("rb"),
+		help = "Path to file to pack"
+	)
+	group.add_argument(
+		"output",
+		type = FileType("wb"),
+		help = "Path to packed file to generate"
+	)
+
+	return parser
+
+def main():
+	parser: ArgumentParser = createParser()
+	args:   Namespace      = parser.parse_args()
+
+	if not 0 <= args.file <= 255:
+		parser.error("file number must be in 0-255 range")
+	if not 0 <= args.channel <= 31:
+		parser.error("channel number must be in 0-31 range")
+
+	with args.input as _file:
+		data: bytes = _file.read()
+
+	output: bytearray = packSectors(data, args.file, args.channel)
+
+	with args.output as _file:
+		_file.write(output)
+
+	sectors: int = len(output) // (PAYLOAD_SIZE + 8 + EDC_SIZE)
+	print(f"{len(data)} bytes -> {sectors} sectors")
+
+if __name__ == "__main__":
+	main()